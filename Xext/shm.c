@@ -576,6 +576,54 @@ ShmPutImage(ClientPtr client, xShmPutImageReq *stuff)
     return Success;
 }
 
+/*
+ * Fetch a ZPixmap image of a window into SHM, skipping the rows which are
+ * entirely outside its visible region: XaceCensorImage blanks those
+ * anyway, so reading them from the screen is wasted work for captures of
+ * partially covered windows. Returns FALSE if the whole image is visible
+ * and nothing needs censoring.
+ */
+static Bool
+ShmGetVisibleImage(DrawablePtr pDraw, RegionPtr pVisibleRegion,
+                   int x, int y, int w, int h, Mask planeMask, char *data)
+{
+    int stride = PixmapBytePad(w, pDraw->depth);
+    BoxRec box = {
+        .x1 = pDraw->x + x, .y1 = pDraw->y + y,
+        .x2 = pDraw->x + x + w, .y2 = pDraw->y + y + h
+    };
+    RegionRec visible;
+    BoxPtr pBox;
+    int nBox, row;
+
+    if (RegionContainsRect(pVisibleRegion, &box) == rgnIN) {
+        (*pDraw->pScreen->GetImage) (pDraw, x, y, w, h, ZPixmap, planeMask,
+                                     data);
+        return FALSE;
+    }
+
+    RegionInit(&visible, &box, 1);
+    RegionIntersect(&visible, &visible, pVisibleRegion);
+
+    /* Boxes come in y-x bands; fetch each band's rows once */
+    pBox = RegionRects(&visible);
+    nBox = RegionNumRects(&visible);
+    row = box.y1;
+    for (int i = 0; i < nBox; i++) {
+        int y1 = max(pBox[i].y1, row);
+        int y2 = pBox[i].y2;
+
+        if (y1 >= y2)
+            continue;
+        (*pDraw->pScreen->GetImage) (pDraw, x, y1 - pDraw->y,
+                                     w, y2 - y1, ZPixmap, planeMask,
+                                     data + (y1 - box.y1) * stride);
+        row = y2;
+    }
+    RegionUninit(&visible);
+    return TRUE;
+}
+
 static int
 ShmGetImage(ClientPtr client, xShmGetImageReq *stuff)
 {
@@ -647,16 +695,20 @@ ShmGetImage(ClientPtr client, xShmGetImageReq *stuff)
     if (length == 0) {
         /* nothing to do */
     }
+    else if (stuff->format == ZPixmap && pVisibleRegion) {
+        if (ShmGetVisibleImage(pDraw, pVisibleRegion, stuff->x, stuff->y,
+                               stuff->width, stuff->height, stuff->planeMask,
+                               shmdesc->addr + stuff->offset))
+            XaceCensorImage(client, pVisibleRegion,
+                    PixmapBytePad(stuff->width, pDraw->depth), pDraw,
+                    stuff->x, stuff->y, stuff->width, stuff->height,
+                    stuff->format, shmdesc->addr + stuff->offset);
+    }
     else if (stuff->format == ZPixmap) {
         (*pDraw->pScreen->GetImage) (pDraw, stuff->x, stuff->y,
                                      stuff->width, stuff->height,
                                      stuff->format, stuff->planeMask,
                                      shmdesc->addr + stuff->offset);
-        if (pVisibleRegion)
-            XaceCensorImage(client, pVisibleRegion,
-                    PixmapBytePad(stuff->width, pDraw->depth), pDraw,
-                    stuff->x, stuff->y, stuff->width, stuff->height,
-                    stuff->format, shmdesc->addr + stuff->offset);
     }
     else {
 
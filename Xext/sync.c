@@ -109,6 +109,8 @@ static const char *WARN_INVALID_COUNTER_ALARM =
 
 static void SyncComputeBracketValues(SyncCounter *);
 
+static void SyncNarrowTriggerRange(SyncTrigger *);
+
 static void SyncInitServerTime(void);
 
 static void SyncInitIdleTime(void);
@@ -208,6 +210,8 @@ SyncAddTriggerToSyncObject(SyncTrigger * pTrigger)
     if (SYNC_COUNTER == pTrigger->pSync->type) {
         pCounter = (SyncCounter *) pTrigger->pSync;
 
+        SyncNarrowTriggerRange(pTrigger);
+
         if (IsSystemCounter(pCounter))
             SyncComputeBracketValues(pCounter);
     }
@@ -438,8 +442,10 @@ SyncInitTrigger(ClientPtr client, SyncTrigger * pTrigger, XID syncObject,
     if (newSyncObject) {
         SyncAddTriggerToSyncObject(pTrigger);
     }
-    else if (IsSystemCounter(pCounter)) {
-        SyncComputeBracketValues(pCounter);
+    else {
+        SyncNarrowTriggerRange(pTrigger);
+        if (IsSystemCounter(pCounter))
+            SyncComputeBracketValues(pCounter);
     }
 
     return Success;
@@ -629,6 +635,7 @@ SyncAlarmTriggerFired(SyncTrigger * pTrigger)
      */
     SyncSendAlarmNotifyEvents(pAlarm);
     pTrigger->test_value = new_test_value;
+    SyncNarrowTriggerRange(pTrigger);
 }
 
 /*  This function is called when an Await unblocks, either as a result
@@ -726,11 +733,85 @@ SyncAwaitTriggerFired(SyncTrigger * pTrigger)
     FreeResource(pAwaitUnion->header.delete_id, X11_RESTYPE_NONE);
 }
 
+/*  Each counter keeps a range of values (trigger_less, trigger_greater)
+ *  it can move within without any of its triggers firing, so that hot
+ *  counters with many alarms attached don't have to check every trigger
+ *  on every change.  The range is recomputed whenever the trigger list is
+ *  walked and only ever narrowed in between, so a stale range just costs
+ *  an extra walk.
+ */
+static void
+SyncInvalidateTriggerRange(SyncCounter *pCounter)
+{
+    pCounter->trigger_less = LLONG_MAX;
+    pCounter->trigger_greater = LLONG_MIN;
+}
+
+static void
+SyncTriggerRange(SyncTrigger *pTrigger, int64_t value,
+                 int64_t *less, int64_t *greater)
+{
+    int64_t test_value = pTrigger->test_value;
+
+    /* an inactive alarm may well test true, but firing it does nothing;
+     * SyncChangeAlarmAttributes narrows the range again on reactivation */
+    if (pTrigger->TriggerFired == SyncAlarmTriggerFired &&
+        ((SyncAlarm *) pTrigger)->state != XSyncAlarmActive)
+        return;
+
+    switch (pTrigger->test_type) {
+    case XSyncPositiveComparison:
+        *greater = min(*greater, test_value);
+        break;
+    case XSyncNegativeComparison:
+        *less = max(*less, test_value);
+        break;
+    case XSyncPositiveTransition:
+        if (value < test_value)
+            *greater = min(*greater, test_value);
+        else if (test_value > LLONG_MIN)
+            *less = max(*less, test_value - 1);    /* re-arms below that */
+        break;
+    case XSyncNegativeTransition:
+        if (value > test_value)
+            *less = max(*less, test_value);
+        else if (test_value < LLONG_MAX)
+            *greater = min(*greater, test_value + 1);
+        break;
+    }
+}
+
+static void
+SyncNarrowTriggerRange(SyncTrigger *pTrigger)
+{
+    SyncCounter *pCounter;
+
+    if (!pTrigger->pSync || pTrigger->pSync->type != SYNC_COUNTER)
+        return;
+
+    pCounter = (SyncCounter *) pTrigger->pSync;
+    SyncTriggerRange(pTrigger, pCounter->value,
+                     &pCounter->trigger_less, &pCounter->trigger_greater);
+}
+
+static void
+SyncComputeTriggerRange(SyncCounter *pCounter)
+{
+    pCounter->trigger_less = LLONG_MIN;
+    pCounter->trigger_greater = LLONG_MAX;
+
+    for (SyncTriggerList *ptl = pCounter->sync.pTriglist; ptl; ptl = ptl->next)
+        SyncTriggerRange(ptl->pTrigger, pCounter->value,
+                         &pCounter->trigger_less, &pCounter->trigger_greater);
+}
+
 static int64_t
 SyncUpdateCounter(SyncCounter *pCounter, int64_t newval)
 {
     int64_t oldval = pCounter->value;
     pCounter->value = newval;
+    /* transitions are relative to the value, so the range is stale now */
+    SyncInvalidateTriggerRange(pCounter);
     return oldval;
 }
 
@@ -743,13 +824,21 @@ SyncChangeCounter(SyncCounter * pCounter, int64_t newval)
     SyncTriggerList *ptl, *pnext;
     int64_t oldval;
 
-    oldval = SyncUpdateCounter(pCounter, newval);
+    if (newval > pCounter->trigger_less && newval < pCounter->trigger_greater) {
+        /* nothing can fire, and the range stays valid for the new value */
+        pCounter->value = newval;
+    }
+    else {
+        oldval = SyncUpdateCounter(pCounter, newval);
+
+        /* run through triggers to see if any become true */
+        for (ptl = pCounter->sync.pTriglist; ptl; ptl = pnext) {
+            pnext = ptl->next;
+            if ((*ptl->pTrigger->CheckTrigger) (ptl->pTrigger, oldval))
+                (*ptl->pTrigger->TriggerFired) (ptl->pTrigger);
+        }
 
-    /* run through triggers to see if any become true */
-    for (ptl = pCounter->sync.pTriglist; ptl; ptl = pnext) {
-        pnext = ptl->next;
-        if ((*ptl->pTrigger->CheckTrigger) (ptl->pTrigger, oldval))
-            (*ptl->pTrigger->TriggerFired) (ptl->pTrigger);
+        SyncComputeTriggerRange(pCounter);
     }
 
     if (IsSystemCounter(pCounter)) {
@@ -919,6 +1008,7 @@ SyncChangeAlarmAttributes(ClientPtr client, SyncAlarm * pAlarm, Mask mask,
 
     /* XXX spec does not really say to do this - needs clarification */
     pAlarm->state = XSyncAlarmActive;
+    SyncNarrowTriggerRange(&pAlarm->trigger);
     return Success;
 }
 
@@ -1002,6 +1092,8 @@ SyncCreateCounter(ClientPtr client, XSyncCounter id, int64_t initialvalue)
 
     pCounter->value = initialvalue;
     pCounter->pSysCounterInfo = NULL;
+    pCounter->trigger_less = LLONG_MIN;
+    pCounter->trigger_greater = LLONG_MAX;
 
     pCounter->sync.initialized = TRUE;
 
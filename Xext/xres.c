@@ -253,7 +253,8 @@ ProcXResQueryClientResources(ClientPtr client)
     if (!counts)
         return BadAlloc;
 
-    FindAllClientResources(resClient, ResFindAllRes, counts);
+    if (!dixGetClientResourceTypeCounts(resClient, counts))
+        FindAllClientResources(resClient, ResFindAllRes, counts);
 
     x_rpcbuf_t rpcbuf = { .swapped = client->swapped, .err_clear = TRUE };
 
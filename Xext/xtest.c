@@ -85,6 +85,14 @@ static InternalEvent *xtest_evlist;
  */
 DeviceIntPtr xtestpointer, xtestkeyboard;
 
+/* Devices whose sprite still has to catch up with faked motion. Replaying
+ * a recorded session sends thousands of FakeInput requests; redrawing the
+ * cursor for every single one of them dominates, so the sprite is synced
+ * once before the server goes to sleep instead.
+ */
+static unsigned char xtest_sprite_pending[(MAXDEVICES + 7) / 8];
+static Bool xtest_sprite_handler_registered;
+
 static int XTestSwapFakeInput(ClientPtr /* client */ ,
                               xReq *    /* req */
     );
@@ -174,6 +182,37 @@ XTestDeviceSendEvents(DeviceIntPtr dev,
         mieqProcessDeviceEvent(dev, &xtest_evlist[i], miPointerGetScreen(inputInfo.pointer));
 }
 
+static void
+XTestSpriteBlockHandler(void *data, void *timeout)
+{
+    DeviceIntPtr dev;
+
+    for (dev = inputInfo.devices; dev; dev = dev->next) {
+        if (BitIsOn(xtest_sprite_pending, dev->id))
+            miPointerUpdateSprite(dev);
+    }
+    memset(xtest_sprite_pending, 0, sizeof(xtest_sprite_pending));
+
+    RemoveBlockAndWakeupHandlers(XTestSpriteBlockHandler,
+                                 (ServerWakeupHandlerProcPtr) NoopDDA, NULL);
+    xtest_sprite_handler_registered = FALSE;
+}
+
+static void
+XTestQueueSpriteUpdate(DeviceIntPtr dev)
+{
+    if (!xtest_sprite_handler_registered) {
+        if (!RegisterBlockAndWakeupHandlers(XTestSpriteBlockHandler,
+                                            (ServerWakeupHandlerProcPtr) NoopDDA,
+                                            NULL)) {
+            miPointerUpdateSprite(dev);
+            return;
+        }
+        xtest_sprite_handler_registered = TRUE;
+    }
+    SetBit(xtest_sprite_pending, dev->id);
+}
+
 static int
 ProcXTestFakeInput(ClientPtr client)
 {
@@ -448,7 +487,7 @@ ProcXTestFakeInput(ClientPtr client)
         (*dev->sendEventsProc) (dev, type, ev->u.u.detail, flags, &mask);
 
     if (need_ptr_update)
-        miPointerUpdateSprite(dev);
+        XTestQueueSpriteUpdate(dev);
     return Success;
 }
 
@@ -635,6 +674,14 @@ XTestExtensionTearDown(ExtensionEntry * e)
 {
     FreeEventList(xtest_evlist, GetMaximumEventsNum());
     xtest_evlist = NULL;
+
+    if (xtest_sprite_handler_registered) {
+        RemoveBlockAndWakeupHandlers(XTestSpriteBlockHandler,
+                                     (ServerWakeupHandlerProcPtr) NoopDDA,
+                                     NULL);
+        xtest_sprite_handler_registered = FALSE;
+    }
+    memset(xtest_sprite_pending, 0, sizeof(xtest_sprite_pending));
 }
 
 void
@@ -44,6 +44,7 @@
 #include <dix-config.h>
 
 #include <stdbool.h>
+#include <string.h>
 
 #include "dix/resource_priv.h"
 #include "os/bug_priv.h"
@@ -272,6 +273,7 @@ compFreeClientWindow(WindowPtr pWin, XID id)
     Bool anyMarked = FALSE;
     WindowPtr pLayerWin;
     PixmapPtr pPixmap = NULL;
+    int pixmapWidth = 0, pixmapHeight = 0;
 
     if (!cw)
         return;
@@ -290,6 +292,8 @@ compFreeClientWindow(WindowPtr pWin, XID id)
 
         if (pWin->redirectDraw != RedirectDrawNone) {
             pPixmap = (*pScreen->GetWindowPixmap) (pWin);
+            pixmapWidth = cw->pixmapWidth;
+            pixmapHeight = cw->pixmapHeight;
             compSetParentPixmap(pWin);
         }
 
@@ -316,7 +320,7 @@ compFreeClientWindow(WindowPtr pWin, XID id)
 
     if (pPixmap) {
         compRestoreWindow(pWin, pPixmap);
-        dixDestroyPixmap(pPixmap, 0);
+        compPoolPutPixmap(pScreen, pPixmap, pixmapWidth, pixmapHeight);
     }
 }
 
@@ -536,15 +540,201 @@ compGetBackgroundState(WindowPtr pWin)
     return pWin->backgroundState;
 }
 
+/*
+ * Window pixmaps can only be recycled, or allocated larger than the
+ * window, when they're plain memory the pixmap header merely describes.
+ */
+static Bool
+compPoolUsable(ScreenPtr pScreen)
+{
+    CompScreenPtr cs = GetCompScreen(pScreen);
+
+    return cs && !cs->poolDisabled &&
+        pScreen->ModifyPixmapHeader == miModifyPixmapHeader;
+}
+
+static void
+compPoolDrop(CompScreenPtr cs, int i)
+{
+    dixDestroyPixmap(cs->pool[i].pPixmap, 0);
+    cs->poolBytes -= cs->pool[i].bytes;
+    cs->pool[i] = cs->pool[--cs->poolCount];
+}
+
+static CARD32
+compPoolTimeout(OsTimerPtr timer, CARD32 now, void *arg)
+{
+    CompScreenPtr cs = GetCompScreen((ScreenPtr) arg);
+    CARD32 next = 0;
+    int i = 0;
+
+    while (i < cs->poolCount) {
+        CARD32 age = now - cs->pool[i].released;
+
+        if (age >= COMP_POOL_IDLE_MS) {
+            compPoolDrop(cs, i);
+            continue;
+        }
+        if (!next || COMP_POOL_IDLE_MS - age < next)
+            next = COMP_POOL_IDLE_MS - age;
+        i++;
+    }
+    return next;
+}
+
+/*
+ * Hand a window pixmap back to the screen. width and height are the
+ * size the pixmap was allocated at, which may exceed its drawable size.
+ * Pixmaps that were ever named for a client are not kept: Damage and
+ * other objects may still be attached to them.
+ */
+void
+compPoolPutPixmap(ScreenPtr pScreen, PixmapPtr pPixmap, int width, int height)
+{
+    CompScreenPtr cs = GetCompScreen(pScreen);
+    size_t bytes;
+
+    if (!compPoolUsable(pScreen) || pPixmap->refcnt != 1 ||
+        *CompPixmapNamed(pPixmap) || !pPixmap->devPrivate.ptr) {
+        dixDestroyPixmap(pPixmap, 0);
+        return;
+    }
+
+    if (width < pPixmap->drawable.width)
+        width = pPixmap->drawable.width;
+    if (height < pPixmap->drawable.height)
+        height = pPixmap->drawable.height;
+    bytes = (size_t) pPixmap->devKind * height;
+    if (bytes > COMP_POOL_MAX_BYTES) {
+        dixDestroyPixmap(pPixmap, 0);
+        return;
+    }
+
+    /* Make room by evicting the least recently released pixmaps */
+    while (cs->poolCount == COMP_POOL_MAX_PIXMAPS ||
+           cs->poolBytes + bytes > COMP_POOL_MAX_BYTES) {
+        int oldest = 0;
+
+        for (int i = 1; i < cs->poolCount; i++)
+            if ((INT32) (cs->pool[i].released - cs->pool[oldest].released) < 0)
+                oldest = i;
+        compPoolDrop(cs, oldest);
+    }
+
+    cs->pool[cs->poolCount].pPixmap = pPixmap;
+    cs->pool[cs->poolCount].width = width;
+    cs->pool[cs->poolCount].height = height;
+    cs->pool[cs->poolCount].bytes = bytes;
+    cs->pool[cs->poolCount].released = GetTimeInMillis();
+    cs->poolBytes += bytes;
+    if (cs->poolCount++ == 0)
+        cs->poolTimer = TimerSet(cs->poolTimer, 0, COMP_POOL_IDLE_MS,
+                                 compPoolTimeout, pScreen);
+}
+
+/*
+ * Find the smallest pooled pixmap which can hold w x h, without
+ * wasting more than twice the wanted size *cap_w x *cap_h. It is
+ * cleared like a new pixmap, so nothing drawn by its previous window
+ * shows through.
+ */
 static PixmapPtr
-compNewPixmap(WindowPtr pWin, int x, int y, int w, int h)
+compPoolGetPixmap(ScreenPtr pScreen, int depth, int w, int h,
+                  int *cap_w, int *cap_h)
+{
+    CompScreenPtr cs = GetCompScreen(pScreen);
+    size_t limit = (size_t) *cap_w * *cap_h * 2;
+    PixmapPtr pPixmap;
+    int best = -1;
+
+    for (int i = 0; i < cs->poolCount; i++) {
+        CompPoolPixmapPtr pp = &cs->pool[i];
+        size_t area = (size_t) pp->width * pp->height;
+
+        if (pp->pPixmap->drawable.depth != depth ||
+            pp->width < w || pp->height < h || area > limit)
+            continue;
+        if (best < 0 ||
+            area < (size_t) cs->pool[best].width * cs->pool[best].height)
+            best = i;
+    }
+    if (best < 0)
+        return NullPixmap;
+
+    pPixmap = cs->pool[best].pPixmap;
+    *cap_w = cs->pool[best].width;
+    *cap_h = cs->pool[best].height;
+    memset(pPixmap->devPrivate.ptr, 0, cs->pool[best].bytes);
+    cs->poolBytes -= cs->pool[best].bytes;
+    cs->pool[best] = cs->pool[--cs->poolCount];
+
+    (*pScreen->ModifyPixmapHeader) (pPixmap, w, h, 0, 0, 0, NULL);
+    pPixmap->drawable.serialNumber = NEXT_SERIAL_NUMBER;
+    return pPixmap;
+}
+
+void
+compPoolFini(ScreenPtr pScreen)
+{
+    CompScreenPtr cs = GetCompScreen(pScreen);
+
+    TimerFree(cs->poolTimer);
+    cs->poolTimer = NULL;
+    while (cs->poolCount)
+        compPoolDrop(cs, cs->poolCount - 1);
+}
+
+/*
+ * Allocate a w x h window pixmap, with room for *cap_w x *cap_h when
+ * the screen allows it. The allocated size is returned in *cap_w/*cap_h.
+ */
+static PixmapPtr
+compCreateWindowPixmap(ScreenPtr pScreen, int depth, int w, int h,
+                       int *cap_w, int *cap_h)
+{
+    PixmapPtr pPixmap = NullPixmap;
+
+    if (compPoolUsable(pScreen))
+        pPixmap = compPoolGetPixmap(pScreen, depth, w, h, cap_w, cap_h);
+    else {
+        *cap_w = w;
+        *cap_h = h;
+    }
+    if (pPixmap)
+        return pPixmap;
+
+    pPixmap = (*pScreen->CreatePixmap) (pScreen, *cap_w, *cap_h, depth,
+                                        CREATE_PIXMAP_USAGE_BACKING_PIXMAP);
+    if (!pPixmap)
+        return NullPixmap;
+
+    if (*cap_w == w && *cap_h == h)
+        return pPixmap;
+
+    if (!pPixmap->devPrivate.ptr) {
+        /* Not CPU memory, stop trying to outsmart the driver */
+        GetCompScreen(pScreen)->poolDisabled = TRUE;
+        dixDestroyPixmap(pPixmap, 0);
+        *cap_w = w;
+        *cap_h = h;
+        return (*pScreen->CreatePixmap) (pScreen, w, h, depth,
+                                         CREATE_PIXMAP_USAGE_BACKING_PIXMAP);
+    }
+
+    (*pScreen->ModifyPixmapHeader) (pPixmap, w, h, 0, 0, 0, NULL);
+    return pPixmap;
+}
+
+static PixmapPtr
+compNewPixmap(WindowPtr pWin, int x, int y, int w, int h,
+              int *cap_w, int *cap_h)
 {
     ScreenPtr pScreen = pWin->drawable.pScreen;
     WindowPtr pParent = pWin->parent;
     PixmapPtr pPixmap;
 
-    pPixmap = (*pScreen->CreatePixmap) (pScreen, w, h, pWin->drawable.depth,
-                                        CREATE_PIXMAP_USAGE_BACKING_PIXMAP);
+    pPixmap = compCreateWindowPixmap(pScreen, pWin->drawable.depth, w, h,
+                                     cap_w, cap_h);
 
     if (!pPixmap)
         return 0;
@@ -620,7 +810,8 @@ compAllocPixmap(WindowPtr pWin)
     int y = pWin->drawable.y - bw;
     int w = pWin->drawable.width + (bw << 1);
     int h = pWin->drawable.height + (bw << 1);
-    PixmapPtr pPixmap = compNewPixmap(pWin, x, y, w, h);
+    int cap_w = w, cap_h = h;
+    PixmapPtr pPixmap = compNewPixmap(pWin, x, y, w, h, &cap_w, &cap_h);
     CompWindowPtr cw = GetCompWindow(pWin);
     Bool status;
 
@@ -628,6 +819,8 @@ compAllocPixmap(WindowPtr pWin)
         status = FALSE;
         goto out;
     }
+    cw->pixmapWidth = cap_w;
+    cw->pixmapHeight = cap_h;
     if (cw->update == CompositeRedirectAutomatic)
         pWin->redirectDraw = RedirectDrawAutomatic;
     else
@@ -677,6 +870,21 @@ compSetParentPixmap(WindowPtr pWin)
     compSetPixmap(pWin, pParentPixmap, pWin->borderWidth);
 }
 
+/*
+ * Size to allocate for a window pixmap growing to size, leaving some
+ * headroom so that an interactive resize can keep reusing the same
+ * couple of pixmaps through the pool instead of allocating every step.
+ */
+static int
+compGrowSize(int size, int limit)
+{
+    int grown = (size + (size >> 2) + 63) & ~63;
+
+    if (grown > limit)
+        grown = max(size, limit);
+    return min(grown, 32767);
+}
+
 /*
  * Make sure the pixmap is the right size and offset.  Allocate a new
  * pixmap to change size, adjust origin to change offset, leaving the
@@ -702,10 +910,20 @@ compReallocPixmap(WindowPtr pWin, int draw_x, int draw_y,
     pix_w = w + (bw << 1);
     pix_h = h + (bw << 1);
     if (pix_w != pOld->drawable.width || pix_h != pOld->drawable.height) {
-        pNew = compNewPixmap(pWin, pix_x, pix_y, pix_w, pix_h);
+        int cap_w = pix_w, cap_h = pix_h;
+
+        if (pix_w > pOld->drawable.width)
+            cap_w = compGrowSize(pix_w, pScreen->width);
+        if (pix_h > pOld->drawable.height)
+            cap_h = compGrowSize(pix_h, pScreen->height);
+        pNew = compNewPixmap(pWin, pix_x, pix_y, pix_w, pix_h, &cap_w, &cap_h);
         if (!pNew)
             return FALSE;
         cw->pOldPixmap = pOld;
+        cw->oldPixmapWidth = cw->pixmapWidth;
+        cw->oldPixmapHeight = cw->pixmapHeight;
+        cw->pixmapWidth = cap_w;
+        cw->pixmapHeight = cap_h;
         compSetPixmap(pWin, pNew, bw);
     }
     else {
@@ -246,6 +246,7 @@ SingleCompositeNameWindowPixmap(ClientPtr client, xCompositeNameWindowPixmapReq
     if (rc != Success)
         return rc;
 
+    *CompPixmapNamed(pPixmap) = TRUE;
     ++pPixmap->refcnt;
 
     if (!AddResource(stuff->pixmap, X11_RESTYPE_PIXMAP, (void *) pPixmap))
@@ -639,6 +640,7 @@ ProcCompositeNameWindowPixmap(ClientPtr client)
             return BadMatch;
         }
 
+        *CompPixmapNamed(pPixmap) = TRUE;
         if (!AddResource(newPix->info[walkScreenIdx].id, X11_RESTYPE_PIXMAP, (void *) pPixmap))
             return BadAlloc;
 
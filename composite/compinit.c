@@ -57,11 +57,14 @@ Bool noCompositeExtension = FALSE;
 DevPrivateKeyRec CompScreenPrivateKeyRec;
 DevPrivateKeyRec CompWindowPrivateKeyRec;
 DevPrivateKeyRec CompSubwindowsPrivateKeyRec;
+DevPrivateKeyRec CompPixmapPrivateKeyRec;
 
 static void compCloseScreen(CallbackListPtr *pcbl, ScreenPtr pScreen, void *unused)
 {
     CompScreenPtr cs = GetCompScreen(pScreen);
 
+    compPoolFini(pScreen);
+
     free(cs->alternateVisuals);
     free(cs->implicitRedirectExceptions);
 
@@ -314,6 +317,9 @@ compScreenInit(ScreenPtr pScreen)
         return FALSE;
     if (!dixRegisterPrivateKey(&CompSubwindowsPrivateKeyRec, PRIVATE_WINDOW, 0))
         return FALSE;
+    if (!dixRegisterPrivateKey(&CompPixmapPrivateKeyRec, PRIVATE_PIXMAP,
+                               sizeof(Bool)))
+        return FALSE;
 
     if (GetCompScreen(pScreen))
         return TRUE;
@@ -91,6 +91,9 @@ typedef struct _CompWindow {
     int oldy;
     PixmapPtr pOldPixmap;
     int borderClipX, borderClipY;
+    /* allocated size of the window pixmap and of pOldPixmap */
+    int pixmapWidth, pixmapHeight;
+    int oldPixmapWidth, oldPixmapHeight;
 } CompWindowRec, *CompWindowPtr;
 
 #define COMP_ORIGIN_INVALID	    0x80000000
@@ -118,6 +121,22 @@ typedef struct _CompImplicitRedirectException {
     XID winVisual;
 } CompImplicitRedirectException;
 
+/*
+ * Released window pixmaps are kept around for a short while so that
+ * redirecting new windows and interactively resizing redirected ones
+ * doesn't have to go back to CreatePixmap for every step.
+ */
+#define COMP_POOL_MAX_PIXMAPS	    8
+#define COMP_POOL_MAX_BYTES	    (64 * 1024 * 1024)
+#define COMP_POOL_IDLE_MS	    1000
+
+typedef struct _CompPoolPixmap {
+    PixmapPtr pPixmap;
+    int width, height;          /* allocated size */
+    size_t bytes;
+    CARD32 released;
+} CompPoolPixmapRec, *CompPoolPixmapPtr;
+
 typedef struct _CompScreen {
     CopyWindowProcPtr CopyWindow;
     CreateWindowProcPtr CreateWindow;
@@ -160,6 +179,12 @@ typedef struct _CompScreen {
     CompOverlayClientPtr pOverlayClients;
 
     SourceValidateProcPtr SourceValidate;
+
+    CompPoolPixmapRec pool[COMP_POOL_MAX_PIXMAPS];
+    int poolCount;
+    size_t poolBytes;
+    OsTimerPtr poolTimer;
+    Bool poolDisabled;
 } CompScreenRec, *CompScreenPtr;
 
 extern DevPrivateKeyRec CompScreenPrivateKeyRec;
@@ -174,12 +199,19 @@ extern DevPrivateKeyRec CompSubwindowsPrivateKeyRec;
 
 #define CompSubwindowsPrivateKey (&CompSubwindowsPrivateKeyRec)
 
+extern DevPrivateKeyRec CompPixmapPrivateKeyRec;
+
+#define CompPixmapPrivateKey (&CompPixmapPrivateKeyRec)
+
 #define GetCompScreen(s) ((CompScreenPtr) \
     dixLookupPrivate(&(s)->devPrivates, CompScreenPrivateKey))
 #define GetCompWindow(w) ((CompWindowPtr) \
     dixLookupPrivate(&(w)->devPrivates, CompWindowPrivateKey))
 #define GetCompSubwindows(w) ((CompSubwindowsPtr) \
     dixLookupPrivate(&(w)->devPrivates, CompSubwindowsPrivateKey))
+/* set once a window pixmap has been named for a client */
+#define CompPixmapNamed(p) ((Bool *) \
+    dixGetPrivateAddr(&(p)->devPrivates, CompPixmapPrivateKey))
 
 extern RESTYPE CompositeClientSubwindowsType;
 extern RESTYPE CompositeClientOverlayType;
@@ -228,6 +260,12 @@ compReallocPixmap(WindowPtr pWin, int x, int y,
 
 void compMarkAncestors(WindowPtr pWin);
 
+void
+compPoolPutPixmap(ScreenPtr pScreen, PixmapPtr pPixmap, int width, int height);
+
+void
+compPoolFini(ScreenPtr pScreen);
+
 /*
  * compinit.c
  */
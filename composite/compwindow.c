@@ -181,7 +181,9 @@ compCheckRedirect(WindowPtr pWin)
 
             compSetParentPixmap(pWin);
             compRestoreWindow(pWin, pPixmap);
-            dixDestroyPixmap(pPixmap, 0);
+            compPoolPutPixmap(pScreen, pPixmap,
+                              cw ? cw->pixmapWidth : 0,
+                              cw ? cw->pixmapHeight : 0);
         }
     }
     else if (should) {
@@ -370,7 +372,8 @@ compFreeOldPixmap(WindowPtr pWin)
         CompWindowPtr cw = GetCompWindow(pWin);
 
         if (cw->pOldPixmap) {
-            dixDestroyPixmap(cw->pOldPixmap, 0);
+            compPoolPutPixmap(pWin->drawable.pScreen, cw->pOldPixmap,
+                              cw->oldPixmapWidth, cw->oldPixmapHeight);
             cw->pOldPixmap = NullPixmap;
         }
     }
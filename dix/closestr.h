@@ -33,6 +33,7 @@ from The Open Group.
 #include "closure.h"
 #include "dix.h"
 #include "misc.h"
+#include "os.h"
 #include "gcstruct.h"
 
 /* closure structures */
@@ -67,6 +68,15 @@ typedef struct _LFWIstate {
     void *private;
 } LFWIstateRec, *LFWIstatePtr;
 
+/* a font listing that used up its time slice, waiting for its next turn */
+typedef struct _FontListSlice {
+    OsTimerPtr timer;
+    ClientPtr client;
+    Bool (*func) (ClientPtr client, void *closure);
+    void *closure;
+    int ignores;                /* IgnoreClient calls not yet undone */
+} FontListSliceRec;
+
 typedef struct _LFWIclosure {
     ClientPtr client;
     int num_fpes;
@@ -78,6 +88,7 @@ typedef struct _LFWIclosure {
     int savedNumFonts;
     Bool haveSaved;
     char *savedName;
+    FontListSliceRec slice;
 } LFWIclosureRec;
 
 /* ListFonts */
@@ -92,6 +103,8 @@ typedef struct _LFclosure {
     Bool haveSaved;
     char *savedName;
     int savedNameLen;
+    unsigned long fontPathSerial;
+    FontListSliceRec slice;
 } LFclosureRec;
 
 /* PolyText */
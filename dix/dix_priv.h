@@ -655,6 +655,13 @@ void WindowHasNewCursor(WindowPtr pWin)
  */
 void WindowsRestructured(void);
 
+/*
+ * Serial of the window hierarchy as far as pointer picking is concerned.
+ * Bumped by WindowsRestructured() and whenever a window is destroyed, so
+ * XYToWindow implementations can cache results between the two.
+ */
+extern unsigned long windowsRestructuredSerial;
+
 /*
  * @brief do post actions necessary whn screens have been restructured
  *
@@ -96,6 +96,27 @@ static int size_slept_fpes = 0;
 static FontPathElementPtr *slept_fpes = (FontPathElementPtr *) 0;
 static xfont2_pattern_cache_ptr patternCache;
 
+/*
+ * ListFonts replies for the current font path.  Local font directories are
+ * only rescanned when the path is (re)set, so as long as no font server or
+ * catalogue is involved the answer for a given pattern stays the same and
+ * repeated queries needn't walk every FPE again.
+ */
+#define LIST_FONTS_CACHE_SIZE 16
+
+typedef struct _ListFontsCacheEntry {
+    char pattern[XLFDMAXFONTNAMELEN];
+    int patlen;
+    int max_names;
+    FontNamesPtr names;
+    unsigned long lastUsed;
+} ListFontsCacheEntryRec;
+
+static ListFontsCacheEntryRec listFontsCache[LIST_FONTS_CACHE_SIZE];
+static unsigned long listFontsCacheClock;
+static unsigned long fontPathSerial;
+static Bool listFontsCacheable;
+
 static int
 FontToXError(int err)
 {
@@ -546,6 +567,163 @@ QueryFont(FontPtr pFont, xQueryFontReply * pReply, int nProtoCCIStructs)
     return;
 }
 
+static void
+ListFontsCacheEmpty(void)
+{
+    for (int i = 0; i < LIST_FONTS_CACHE_SIZE; i++) {
+        if (listFontsCache[i].names)
+            xfont2_free_font_names(listFontsCache[i].names);
+        listFontsCache[i].names = NULL;
+    }
+}
+
+static ListFontsCacheEntryRec *
+ListFontsCacheFind(const char *pattern, int patlen, int max_names)
+{
+    for (int i = 0; i < LIST_FONTS_CACHE_SIZE; i++) {
+        ListFontsCacheEntryRec *e = &listFontsCache[i];
+
+        if (e->names && e->patlen == patlen && e->max_names == max_names &&
+            !memcmp(e->pattern, pattern, patlen)) {
+            e->lastUsed = ++listFontsCacheClock;
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static void
+ListFontsCacheStore(const char *pattern, int patlen, int max_names,
+                    FontNamesPtr names)
+{
+    ListFontsCacheEntryRec *e = &listFontsCache[0];
+    FontNamesPtr copy;
+
+    if (ListFontsCacheFind(pattern, patlen, max_names))
+        return;
+
+    copy = xfont2_make_font_names_record(names->nnames ? names->nnames : 1);
+    if (!copy)
+        return;
+    for (int i = 0; i < names->nnames; i++) {
+        if (xfont2_add_font_names_name(copy, names->names[i],
+                                       names->length[i]) != Successful) {
+            xfont2_free_font_names(copy);
+            return;
+        }
+    }
+
+    /* take a free slot, or else the least recently used one */
+    for (int i = 0; i < LIST_FONTS_CACHE_SIZE; i++) {
+        if (!listFontsCache[i].names) {
+            e = &listFontsCache[i];
+            break;
+        }
+        if (listFontsCache[i].lastUsed < e->lastUsed)
+            e = &listFontsCache[i];
+    }
+    if (e->names)
+        xfont2_free_font_names(e->names);
+
+    memcpy(e->pattern, pattern, patlen);
+    e->patlen = patlen;
+    e->max_names = max_names;
+    e->names = copy;
+    e->lastUsed = ++listFontsCacheClock;
+}
+
+/* only plain font directories and the built-ins are safe to cache */
+static Bool
+ListFontsPathCacheable(FontPathElementPtr *list, int n)
+{
+    for (int i = 0; i < n; i++) {
+        if (list[i]->name[0] != '/' && strcmp(list[i]->name, "built-ins"))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static int
+SendListFontsReply(ClientPtr client, FontNamesPtr names)
+{
+    xListFontsReply reply = {
+        .nFonts = names->nnames,
+    };
+
+    x_rpcbuf_t rpcbuf = { .swapped = client->swapped, .err_clear = TRUE };
+    for (int i = 0; i < names->nnames; i++) {
+        if (names->length[i] > 255)
+            reply.nFonts--;
+        else {
+            /* write a pascal string */
+            x_rpcbuf_write_CARD8(&rpcbuf, names->length[i]);
+            x_rpcbuf_write_CARD8s(&rpcbuf, (CARD8*)names->names[i], names->length[i]);
+        }
+    }
+
+    if (rpcbuf.error)
+        return BadAlloc;
+
+    if (client->swapped) {
+        swaps(&reply.nFonts);
+    }
+
+    X_SEND_REPLY_WITH_RPCBUF(client, reply, rpcbuf);
+    return Success;
+}
+
+/*
+ * Long font listings are processed in slices so that one client walking a
+ * large font path doesn't stall everybody else.  Once a slice has used up
+ * its time budget the client is put to sleep and a short timer is armed;
+ * only when that fires is the listing queued to resume from the work
+ * queue, so other clients get dispatched in between.  Signalling the
+ * client straight away would not do: from inside a work proc that queues
+ * the listing behind itself, to be run again in the same pass.
+ */
+#define FONT_LIST_TIME_SLICE 20 /* ms */
+
+static CARD32
+FontListResume(OsTimerPtr timer, CARD32 now, void *arg)
+{
+    FontListSliceRec *slice = arg;
+
+    if (!QueueWorkProc(slice->func, slice->client, slice->closure))
+        return 1;               /* try again shortly */
+
+    /* Trade the sleep queue entry for a plain ignore, so that the client
+     * isn't signalled a second time (running the closure again after it
+     * was freed) should it go away before the work proc gets to run.
+     */
+    IgnoreClient(slice->client);
+    ClientWakeup(slice->client);
+    slice->ignores++;
+    return 0;
+}
+
+static Bool
+FontListYield(FontListSliceRec *slice, ClientPtr client,
+              ClientSleepProcPtr func, void *closure, CARD32 start)
+{
+    if ((CARD32) (GetTimeInMillis() - start) < FONT_LIST_TIME_SLICE)
+        return FALSE;
+    if (!ClientIsAsleep(client) && !ClientSleep(client, func, closure))
+        return FALSE;
+    slice->client = client;
+    slice->func = func;
+    slice->closure = closure;
+    slice->timer = TimerSet(slice->timer, 0, 1, FontListResume, slice);
+    return slice->timer != NULL;
+}
+
+static void
+FontListSliceFini(FontListSliceRec *slice)
+{
+    TimerFree(slice->timer);
+    for (; slice->ignores > 0; slice->ignores--)
+        AttendClient(slice->client);
+}
+
 static Bool
 doListFontsAndAliases(ClientPtr client, LFclosurePtr c)
 {
@@ -555,6 +733,7 @@ doListFontsAndAliases(ClientPtr client, LFclosurePtr c)
     char *name, *resolved = NULL;
     int namelen, resolvedlen;
     int aliascount = 0;
+    CARD32 start = GetTimeInMillis();
 
     if (client->clientGone) {
         if (c->current.current_fpe < c->num_fpes) {
@@ -569,6 +748,14 @@ doListFontsAndAliases(ClientPtr client, LFclosurePtr c)
         goto finish;
 
     while (c->current.current_fpe < c->num_fpes) {
+        /* alias resolution keeps state on the stack, don't yield inside it */
+        if (!c->haveSaved &&
+            FontListYield(&c->slice, client,
+                          (ClientSleepProcPtr) doListFontsAndAliases,
+                          c, start)) {
+            free(resolved);
+            return TRUE;
+        }
         fpe = c->fpe_list[c->current.current_fpe];
         err = Successful;
 
@@ -731,34 +918,17 @@ doListFontsAndAliases(ClientPtr client, LFclosurePtr c)
     names = c->names;
     client = c->client;
 
-    xListFontsReply reply = {
-        .nFonts = names->nnames,
-    };
-
-    x_rpcbuf_t rpcbuf = { .swapped = client->swapped, .err_clear = TRUE };
-    for (int i = 0; i < names->nnames; i++) {
-        if (names->length[i] > 255)
-            reply.nFonts--;
-        else {
-            /* write a pascal string */
-            x_rpcbuf_write_CARD8(&rpcbuf, names->length[i]);
-            x_rpcbuf_write_CARD8s(&rpcbuf, (CARD8*)names->names[i], names->length[i]);
-        }
-    }
+    if (listFontsCacheable && c->fontPathSerial == fontPathSerial &&
+        !c->haveSaved)
+        ListFontsCacheStore(c->current.pattern, c->current.patlen,
+                            c->current.max_names, names);
 
-    if (rpcbuf.error) {
+    if (SendListFontsReply(client, names) != Success)
         SendErrorToClient(client, X_ListFonts, 0, 0, BadAlloc);
-        goto bail;
-    }
-
-    if (client->swapped) {
-        swaps(&reply.nFonts);
-    }
-
-    X_SEND_REPLY_WITH_RPCBUF(client, reply, rpcbuf);
 
  bail:
     ClientWakeup(client);
+    FontListSliceFini(&c->slice);
     for (int i = 0; i < c->num_fpes; i++)
         FreeFPE(c->fpe_list[i]);
     free(c->fpe_list);
@@ -789,6 +959,14 @@ ListFonts(ClientPtr client, unsigned char *pattern, unsigned length,
     if (access != Success)
         return access;
 
+    if (listFontsCacheable && length) {
+        ListFontsCacheEntryRec *e =
+            ListFontsCacheFind((char *) pattern, length, max_names);
+
+        if (e)
+            return SendListFontsReply(client, e->names);
+    }
+
     if (!(c = calloc(1, sizeof *c)))
         return BadAlloc;
     c->fpe_list = calloc(num_fpes, sizeof(FontPathElementPtr));
@@ -816,6 +994,7 @@ ListFonts(ClientPtr client, unsigned char *pattern, unsigned length,
     c->current.private = 0;
     c->haveSaved = FALSE;
     c->savedName = 0;
+    c->fontPathSerial = fontPathSerial;
     doListFontsAndAliases(client, c);
     return Success;
 }
@@ -832,6 +1011,7 @@ doListFontsWithInfo(ClientPtr client, LFWIclosurePtr c)
     int length;
     xFontProp *pFP;
     int aliascount = 0;
+    CARD32 start = GetTimeInMillis();
 
     if (client->clientGone) {
         if (c->current.current_fpe < c->num_fpes) {
@@ -844,6 +1024,11 @@ doListFontsWithInfo(ClientPtr client, LFWIclosurePtr c)
     if (!c->current.patlen)
         goto finish;
     while (c->current.current_fpe < c->num_fpes) {
+        if (!c->haveSaved &&
+            FontListYield(&c->slice, client,
+                          (ClientSleepProcPtr) doListFontsWithInfo,
+                          c, start))
+            return TRUE;
         fpe = c->fpe_list[c->current.current_fpe];
         err = Successful;
         if (!c->current.list_started) {
@@ -1036,6 +1221,7 @@ doListFontsWithInfo(ClientPtr client, LFWIclosurePtr c)
     X_SEND_REPLY_SIMPLE(client, reply);
  bail:
     ClientWakeup(client);
+    FontListSliceFini(&c->slice);
     for (int i = 0; i < c->num_fpes; i++)
         FreeFPE(c->fpe_list[i]);
     free(c->reply);
@@ -1670,6 +1856,9 @@ SetFontPathElements(int npaths, unsigned char *paths, int *bad, Bool persist)
     if (patternCache)
         xfont2_empty_font_pattern_cache(patternCache);
     num_fpes = valid_paths;
+    ListFontsCacheEmpty();
+    listFontsCacheable = ListFontsPathCacheable(font_path_elements, num_fpes);
+    fontPathSerial++;
 
     return Success;
  bail:
@@ -1853,6 +2042,9 @@ FreeFonts(void)
         xfont2_free_font_pattern_cache(patternCache);
         patternCache = 0;
     }
+    ListFontsCacheEmpty();
+    listFontsCacheable = FALSE;
+    fontPathSerial++;
     FreeFontPath(font_path_elements, num_fpes, TRUE);
     font_path_elements = 0;
     num_fpes = 0;
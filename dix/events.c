@@ -3265,11 +3265,15 @@ CheckMotion(DeviceEvent *ev, DeviceIntPtr pDev)
  * Windows have restructured, we need to update the sprite position and the
  * sprite's cursor.
  */
+unsigned long windowsRestructuredSerial = 1;
+
 void
 WindowsRestructured(void)
 {
     DeviceIntPtr pDev = inputInfo.devices;
 
+    windowsRestructuredSerial++;
+
     while (pDev) {
         if (InputDevIsMaster(pDev) || InputDevIsFloating(pDev))
             CheckMotion(NULL, pDev);
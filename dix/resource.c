@@ -175,6 +175,9 @@ typedef struct _ClientResource {
     int hashsize;               /* log(2)(buckets) */
     XID fakeID;
     XID endFakeID;
+    int *typeCounts;            /* resources per type, indexed by type & TypeMask */
+    int numTypeCounts;
+    Bool typeCountsBroken;      /* allocation failed, counts can't be trusted */
 } ClientResourceRec;
 
 RESTYPE lastResourceType;
@@ -662,6 +665,9 @@ InitClientResources(ClientPtr client)
     clientTable[i].buckets = INITBUCKETS;
     clientTable[i].elements = 0;
     clientTable[i].hashsize = INITHASHSIZE;
+    clientTable[i].typeCounts = NULL;
+    clientTable[i].numTypeCounts = 0;
+    clientTable[i].typeCountsBroken = FALSE;
     /* Many IDs allocated from the server client are visible to clients,
      * so we don't use the SERVER_BIT for them, but we have to start
      * past the magic value constants used in the protocol.  For normal
@@ -811,6 +817,36 @@ FakeClientID(int client)
     return id;
 }
 
+static void
+AdjustTypeCount(ClientResourceRec *rrec, RESTYPE type, int delta)
+{
+    int idx = type & TypeMask;
+
+    if (rrec->typeCountsBroken)
+        return;
+
+    if (idx >= rrec->numTypeCounts) {
+        int num = lastResourceType + 1;
+        int *counts;
+
+        if (idx >= num)
+            num = idx + 1;
+        counts = reallocarray(rrec->typeCounts, num, sizeof(int));
+        if (!counts) {
+            free(rrec->typeCounts);
+            rrec->typeCounts = NULL;
+            rrec->numTypeCounts = 0;
+            rrec->typeCountsBroken = TRUE;
+            return;
+        }
+        memset(counts + rrec->numTypeCounts, 0,
+               (num - rrec->numTypeCounts) * sizeof(int));
+        rrec->typeCounts = counts;
+        rrec->numTypeCounts = num;
+    }
+    rrec->typeCounts[idx] += delta;
+}
+
 Bool
 AddResource(XID id, RESTYPE type, void *value)
 {
@@ -842,10 +878,29 @@ AddResource(XID id, RESTYPE type, void *value)
     res->value = value;
     *head = res;
     rrec->elements++;
+    AdjustTypeCount(rrec, type, 1);
     CallResourceStateCallback(ResourceStateAdding, res);
     return TRUE;
 }
 
+Bool
+dixGetClientResourceTypeCounts(ClientPtr client, int *counts)
+{
+    ClientResourceRec *rrec;
+
+    if (!client)
+        client = serverClient;
+    rrec = &clientTable[client->index];
+
+    if (rrec->typeCountsBroken)
+        return FALSE;
+
+    memset(counts, 0, (lastResourceType + 1) * sizeof(int));
+    for (int i = 1; i < rrec->numTypeCounts && i <= lastResourceType + 1; i++)
+        counts[i - 1] = rrec->typeCounts[i];
+    return TRUE;
+}
+
 static void
 RebuildTable(int client)
 {
@@ -922,6 +977,7 @@ FreeResource(XID id, RESTYPE skipDeleteFuncType)
 #endif
                 *prev = res->next;
                 elements = --*eltptr;
+                AdjustTypeCount(&clientTable[cid], rtype, -1);
 
                 doFreeResource(res, rtype == skipDeleteFuncType);
 
@@ -953,6 +1009,7 @@ FreeResourceByType(XID id, RESTYPE type, Bool skipFree)
 #endif
                 *prev = res->next;
                 clientTable[cid].elements--;
+                AdjustTypeCount(&clientTable[cid], type, -1);
 
                 doFreeResource(res, skipFree);
 
@@ -1102,6 +1159,7 @@ FreeClientNeverRetainResources(ClientPtr client)
 #endif
                 *prev = this->next;
                 clientTable[client->index].elements--;
+                AdjustTypeCount(&clientTable[client->index], rtype, -1);
                 elements = *eltptr;
 
                 doFreeResource(this, FALSE);
@@ -1150,6 +1208,7 @@ FreeClientResources(ClientPtr client)
 #endif
             *head = this->next;
             clientTable[client->index].elements--;
+            AdjustTypeCount(&clientTable[client->index], this->type, -1);
 
             doFreeResource(this, FALSE);
         }
@@ -1157,6 +1216,9 @@ FreeClientResources(ClientPtr client)
     free(clientTable[client->index].resources);
     clientTable[client->index].resources = NULL;
     clientTable[client->index].buckets = 0;
+    free(clientTable[client->index].typeCounts);
+    clientTable[client->index].typeCounts = NULL;
+    clientTable[client->index].numTypeCounts = 0;
 }
 
 void
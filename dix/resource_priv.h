@@ -157,6 +157,20 @@ void GetXIDRange(int client,
                  XID *minp,
                  XID *maxp);
 
+/*
+ * @brief retrieve the number of resources per type owned by a client
+ *
+ * The counts are kept up to date as resources are added and freed, so this
+ * doesn't need to walk the client's resource table.
+ *
+ * @param client the client to query (NULL for the server client)
+ * @param counts array of lastResourceType + 1 entries, filled in with the
+ *               count for type (i + 1) at index i
+ * @result FALSE if the counts aren't available and the caller has to
+ *         count the resources itself
+ */
+Bool dixGetClientResourceTypeCounts(ClientPtr client, int *counts);
+
 /* Resource state callback */
 extern CallbackListPtr ResourceStateCallback;
 
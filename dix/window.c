@@ -1045,6 +1045,9 @@ DeleteWindow(void *value, XID wid)
     WindowPtr pParent;
     WindowPtr pWin = (WindowPtr) value;
 
+    /* Don't let anyone hold on to a cached sprite trace through us */
+    windowsRestructuredSerial++;
+
     UnmapWindow(pWin, FALSE);
 
     CrushTree(pWin);
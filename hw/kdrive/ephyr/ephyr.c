@@ -293,20 +293,140 @@ ephyrUnmapFramebuffer(KdScreenInfo * screen)
     return TRUE;
 }
 
+/*
+ * Every upload is a request (and for plain XImages a copy of the rectangle)
+ * of its own, so a fragmented region is better sent as fewer, larger
+ * rectangles.  A box is merged into a rectangle already being sent if that
+ * grows it by no more than EPHYR_PAINT_MERGE_PIXELS, about what a request
+ * of its own costs, and never more than EPHYR_PAINT_MAX_RECTS are sent.
+ */
+#define EPHYR_PAINT_MAX_RECTS   16
+#define EPHYR_PAINT_MERGE_PIXELS (64 * 64)
+
+static inline int
+ephyrBoxArea(const BoxRec *box)
+{
+    return (box->x2 - box->x1) * (box->y2 - box->y1);
+}
+
+static void
+ephyrPaintRegion(KdScreenInfo *screen, RegionPtr pRegion)
+{
+    BoxRec rects[EPHYR_PAINT_MAX_RECTS];
+    int nrects = 0;
+    int nbox = RegionNumRects(pRegion);
+    BoxPtr pbox = RegionRects(pRegion);
+    int extra = 0;
+
+    for (int i = 0; i < nbox; i++, pbox++) {
+        int best = -1, bestCost = INT_MAX;
+
+        for (int j = 0; j < nrects; j++) {
+            BoxRec merged = {
+                min(rects[j].x1, pbox->x1), min(rects[j].y1, pbox->y1),
+                max(rects[j].x2, pbox->x2), max(rects[j].y2, pbox->y2)
+            };
+            int cost = ephyrBoxArea(&merged) - ephyrBoxArea(&rects[j]) -
+                ephyrBoxArea(pbox);
+
+            if (cost < bestCost) {
+                best = j;
+                bestCost = cost;
+            }
+        }
+
+        if (best >= 0 &&
+            (bestCost <= EPHYR_PAINT_MERGE_PIXELS ||
+             nrects == EPHYR_PAINT_MAX_RECTS)) {
+            BoxPtr r = &rects[best];
+
+            r->x1 = min(r->x1, pbox->x1);
+            r->y1 = min(r->y1, pbox->y1);
+            r->x2 = max(r->x2, pbox->x2);
+            r->y2 = max(r->y2, pbox->y2);
+            extra += max(bestCost, 0);
+        }
+        else
+            rects[nrects++] = *pbox;
+    }
+
+    EPHYR_DBG("painting %d boxes as %d rects, %d extra pixels",
+              nbox, nrects, extra);
+
+    for (int i = 0; i < nrects; i++)
+        hostx_paint_rect(screen,
+                         rects[i].x1, rects[i].y1, rects[i].x1, rects[i].y1,
+                         rects[i].x2 - rects[i].x1, rects[i].y2 - rects[i].y1,
+                         i == nrects - 1);
+}
+
+/*
+ * Map a box of the shadow to where shadowUpdateRotatePacked() puts it in
+ * the host window: reflect within the shadow first, then rotate.
+ */
+static void
+ephyrShadowBoxToScreen(shadowBufPtr pBuf, const BoxRec *sha, BoxPtr scr)
+{
+    int width = pBuf->pPixmap->drawable.width;
+    int height = pBuf->pPixmap->drawable.height;
+    int x1 = sha->x1, y1 = sha->y1, x2 = sha->x2, y2 = sha->y2;
+    int t;
+
+    if (pBuf->randr & SHADOW_REFLECT_X) {
+        t = x1;
+        x1 = width - x2;
+        x2 = width - t;
+    }
+    if (pBuf->randr & SHADOW_REFLECT_Y) {
+        t = y1;
+        y1 = height - y2;
+        y2 = height - t;
+    }
+
+    switch (pBuf->randr & SHADOW_ROTATE_ALL) {
+    case SHADOW_ROTATE_0:
+    default:
+        *scr = (BoxRec) { x1, y1, x2, y2 };
+        break;
+    case SHADOW_ROTATE_90:
+        *scr = (BoxRec) { y1, width - x2, y2, width - x1 };
+        break;
+    case SHADOW_ROTATE_180:
+        *scr = (BoxRec) { width - x2, height - y2, width - x1, height - y1 };
+        break;
+    case SHADOW_ROTATE_270:
+        *scr = (BoxRec) { height - y2, x1, height - y1, x2 };
+        break;
+    }
+}
+
 void
 ephyrShadowUpdate(ScreenPtr pScreen, shadowBufPtr pBuf)
 {
     KdScreenPriv(pScreen);
     KdScreenInfo *screen = pScreenPriv->screen;
+    RegionPtr damage = DamageRegion(pBuf->pDamage);
+    int nbox = RegionNumRects(damage);
+    BoxPtr pbox = RegionRects(damage);
+    RegionRec region, box;
 
     EPHYR_LOG("slow paint");
 
-    /* FIXME: Slow Rotated/Reflected updates could be much
-     * much faster efficiently updating via transforming
-     * pBuf->pDamage  regions
-     */
+    /* only the damaged boxes are rotated, so only upload those */
     shadowUpdateRotatePacked(pScreen, pBuf);
-    hostx_paint_rect(screen, 0, 0, 0, 0, screen->width, screen->height, TRUE);
+
+    RegionNull(&region);
+    while (nbox--) {
+        BoxRec b;
+
+        ephyrShadowBoxToScreen(pBuf, pbox, &b);
+        RegionInit(&box, &b, 1);
+        RegionUnion(&region, &region, &box);
+        RegionUninit(&box);
+        pbox++;
+    }
+    ephyrPaintRegion(screen, &region);
+    RegionUninit(&region);
 }
 
 static void
@@ -323,23 +443,10 @@ ephyrInternalDamageRedisplay(ScreenPtr pScreen)
     pRegion = DamageRegion(scrpriv->pDamage);
 
     if (RegionNotEmpty(pRegion)) {
-        int nbox;
-        BoxPtr pbox;
-
         if (ephyr_glamor) {
             ephyr_glamor_damage_redisplay(scrpriv->glamor, pRegion);
         } else {
-            nbox = RegionNumRects(pRegion);
-            pbox = RegionRects(pRegion);
-
-            while (nbox--) {
-                hostx_paint_rect(screen,
-                                 pbox->x1, pbox->y1,
-                                 pbox->x1, pbox->y1,
-                                 pbox->x2 - pbox->x1, pbox->y2 - pbox->y1,
-                                 nbox == 0);
-                pbox++;
-            }
+            ephyrPaintRegion(screen, pRegion);
         }
         DamageEmpty(scrpriv->pDamage);
     }
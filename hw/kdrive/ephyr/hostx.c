@@ -63,6 +63,7 @@
 #include <xcb/xcb_keysyms.h>
 #include <xcb/randr.h>
 #include <xcb/xkb.h>
+#include <pixman.h>
 #ifdef GLAMOR
 #include <xcb/glx.h>
 #include <epoxy/common.h>
@@ -1029,6 +1030,67 @@ hostx_screen_init(KdScreenInfo *screen,
 static void hostx_paint_debug_rect(KdScreenInfo *screen,
                                    int x, int y, int width, int height);
 
+/*
+ * Convert a rectangle of fb_data into the host image a row at a time, for
+ * the usual case of a host image with 32bpp pixels in our own byte order.
+ * Direct color goes through pixman, which has SIMD paths for these
+ * conversions; 8bpp is looked up in the colormap.  Returns FALSE if the
+ * host image has some other layout and the caller has to go pixel by pixel.
+ */
+static Bool
+hostx_convert_rect(EphyrScrPriv *scrpriv, int x, int y, int width, int height)
+{
+    xcb_image_t *ximg = scrpriv->ximg;
+    int bytes_per_pixel = scrpriv->server_depth >> 3;
+    int stride = (scrpriv->win_width * bytes_per_pixel + 0x3) & ~0x3;
+    pixman_format_code_t format;
+    pixman_image_t *src, *dst;
+
+    if (ximg->bpp != 32 || ximg->byte_order != IMAGE_BYTE_ORDER)
+        return FALSE;
+
+    switch (scrpriv->server_depth) {
+    case 8:
+    {
+        int row, col;
+
+        for (row = y; row < y + height; row++) {
+            const uint8_t *s = scrpriv->fb_data + row * stride + x;
+            uint32_t *d = (uint32_t *) (ximg->data + row * ximg->stride) + x;
+
+            for (col = 0; col < width; col++)
+                d[col] = scrpriv->cmap[s[col]];
+        }
+        return TRUE;
+    }
+    case 16:
+        format = PIXMAN_r5g6b5;
+        break;
+    case 24:
+        format = PIXMAN_r8g8b8;
+        break;
+    case 32:
+        format = PIXMAN_x8r8g8b8;
+        break;
+    default:
+        return FALSE;
+    }
+
+    src = pixman_image_create_bits(format, x + width, y + height,
+                                   (uint32_t *) scrpriv->fb_data, stride);
+    dst = pixman_image_create_bits(PIXMAN_x8r8g8b8, x + width, y + height,
+                                   (uint32_t *) ximg->data, ximg->stride);
+    if (src && dst)
+        pixman_image_composite32(PIXMAN_OP_SRC, src, NULL, dst,
+                                 x, y, 0, 0, x, y, width, height);
+    if (src)
+        pixman_image_unref(src);
+    if (dst)
+        pixman_image_unref(dst);
+
+    return src && dst;
+}
+
 void
 hostx_paint_rect(KdScreenInfo *screen,
                  int sx, int sy, int dx, int dy, int width, int height,
@@ -1076,7 +1138,8 @@ hostx_paint_rect(KdScreenInfo *screen,
      *       ... and it will be slower than the matching depth case.
      */
 
-    if (!host_depth_matches_server(scrpriv)) {
+    if (!host_depth_matches_server(scrpriv) &&
+        !hostx_convert_rect(scrpriv, sx, sy, width, height)) {
         int x, y, idx, bytes_per_pixel = (scrpriv->server_depth >> 3);
         int stride = (scrpriv->win_width * bytes_per_pixel + 0x3) & ~0x3;
         unsigned char r, g, b;
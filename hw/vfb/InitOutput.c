@@ -58,6 +58,7 @@ from The Open Group.
 #include <sys/types.h>
 #ifdef HAVE_MMAP
 #include <sys/mman.h>
+#include <unistd.h>
 #ifndef MAP_FILE
 #define MAP_FILE 0
 #endif
@@ -73,9 +74,13 @@ from The Open Group.
 #include <sys/shm.h>
 #endif /* CONFIG-MITSHM */
 #include "dix.h"
+#include "damage.h"
 #include "miline.h"
 #include "glx_extinit.h"
 #include "randrstr.h"
+#ifdef CONFIG_MITSHM
+#include "vfbring.h"
+#endif
 
 #define VFB_DEFAULT_WIDTH      1280
 #define VFB_DEFAULT_HEIGHT     1024
@@ -112,14 +117,18 @@ typedef struct {
     Pixel whitePixel;
     unsigned int lineBias;
     CloseScreenProcPtr closeScreen;
+    CreateScreenResourcesProcPtr createScreenResources;
 
 #ifdef HAVE_MMAP
     int mmap_fd;
     char mmap_file[MAXPATHLEN];
+    DamagePtr pDamage;          /* what needs flushing to the file */
+    Bool headerDirty;           /* XWD header or colormap changed */
 #endif
 
 #ifdef CONFIG_MITSHM
     int shmid;
+    vfbRingPtr ring;
 #endif /* CONFIG_MITSHM */
 } vfbScreenInfo, *vfbScreenInfoPtr;
 
@@ -142,6 +151,13 @@ static char *pfbdir = NULL;
 #endif
 typedef enum { NORMAL_MEMORY_FB, SHARED_MEMORY_FB, MMAPPED_FILE_FB } fbMemType;
 static fbMemType fbmemtype = NORMAL_MEMORY_FB;
+
+#ifdef CONFIG_MITSHM
+#define VFB_DEFAULT_RING_FPS      30
+static int vfbRingSlots = 0;
+static int vfbRingFps = VFB_DEFAULT_RING_FPS;
+#endif
+
 static char needswap = 0;
 static Bool Render = TRUE;
 
@@ -298,6 +314,9 @@ ddxUseMsg(void)
 
 #ifdef CONFIG_MITSHM
     ErrorF("-shmem                 put framebuffers in shared memory\n");
+    ErrorF("-fbring n              publish frames in a shared memory ring of n buffers\n");
+    ErrorF("-fbringfps fps         maximum frame rate of the ring (default: %d)\n",
+           VFB_DEFAULT_RING_FPS);
 #endif /* CONFIG_MITSHM */
 
     ErrorF("-crtcs n               number of CRTCs per screen (default: %d)\n",
@@ -418,6 +437,30 @@ ddxProcessArgument(int argc, char *argv[], int i)
         fbmemtype = SHARED_MEMORY_FB;
         return 1;
     }
+
+    if (strcmp(argv[i], "-fbring") == 0) {      /* -fbring n */
+        CHECK_FOR_REQUIRED_ARGUMENTS(1);
+        vfbRingSlots = atoi(argv[++i]);
+        if (vfbRingSlots < 2 || vfbRingSlots > 64) {
+            ErrorF("Invalid number of ring buffers %d\n", vfbRingSlots);
+            UseMsg();
+            FatalError("Invalid number of ring buffers (%d) passed to -fbring\n",
+                       vfbRingSlots);
+        }
+        return 2;
+    }
+
+    if (strcmp(argv[i], "-fbringfps") == 0) {   /* -fbringfps fps */
+        CHECK_FOR_REQUIRED_ARGUMENTS(1);
+        vfbRingFps = atoi(argv[++i]);
+        if (vfbRingFps < 1 || vfbRingFps > 1000) {
+            ErrorF("Invalid ring frame rate %d\n", vfbRingFps);
+            UseMsg();
+            FatalError("Invalid ring frame rate (%d) passed to -fbringfps\n",
+                       vfbRingFps);
+        }
+        return 2;
+    }
 #endif /* CONFIG_MITSHM */
 
     if (strcmp(argv[i], "-crtcs") == 0) {       /* -crtcs n */
@@ -467,6 +510,9 @@ vfbInstallColormap(ColormapPtr pmap)
         swapcopy32(pXWDHeader->blue_mask, pVisual->blueMask);
         swapcopy32(pXWDHeader->bits_per_rgb, pVisual->bitsPerRGBValue);
         swapcopy32(pXWDHeader->colormap_entries, pVisual->ColormapEntries);
+#ifdef HAVE_MMAP
+        vfbScreens[pmap->pScreen->myNum].headerDirty = TRUE;
+#endif
 
         ppix = calloc(entries, sizeof(Pixel));
         prgb = calloc(entries, sizeof(xrgb));
@@ -511,6 +557,10 @@ vfbStoreColors(ColormapPtr pmap, int ndef, xColorItem * pdefs)
         return;
     }
 
+#ifdef HAVE_MMAP
+    vfbScreens[pmap->pScreen->myNum].headerDirty = TRUE;
+#endif
+
     for (i = 0; i < ndef; i++) {
         if (pdefs[i].flags & DoRed) {
             swapcopy16(pXWDCmap[pdefs[i].pixel].red, pdefs[i].red);
@@ -526,26 +576,78 @@ vfbStoreColors(ColormapPtr pmap, int ndef, xColorItem * pdefs)
 
 #ifdef HAVE_MMAP
 
-/* this flushes any changes to the screens out to the mmapped file */
 static void
-vfbBlockHandler(void *blockData, void *timeout)
+vfbSyncRange(vfbScreenInfoPtr pvfb, char *start, char *end)
 {
-    int i;
+    char *base = (char *) pvfb->pXWDHeader;
+    uintptr_t pagemask = (uintptr_t) getpagesize() - 1;
+
+    /* msync wants a page aligned address; the mapping itself is */
+    start = base + (((uintptr_t) (start - base)) & ~pagemask);
+    if (end > base + pvfb->sizeInBytes)
+        end = base + pvfb->sizeInBytes;
+    if (start >= end)
+        return;
 
-    for (i = 0; i < vfbNumScreens; i++) {
 #ifdef MS_ASYNC
-        if (-1 == msync((caddr_t) vfbScreens[i].pXWDHeader,
-                        (size_t) vfbScreens[i].sizeInBytes, MS_ASYNC))
+    if (-1 == msync((caddr_t) start, (size_t) (end - start), MS_ASYNC))
 #else
-        /* silly NetBSD and who else? */
-        if (-1 == msync((caddr_t) vfbScreens[i].pXWDHeader,
-                        (size_t) vfbScreens[i].sizeInBytes))
+    /* silly NetBSD and who else? */
+    if (-1 == msync((caddr_t) start, (size_t) (end - start)))
 #endif
-        {
-            perror("msync");
-            ErrorF("msync failed, %s", strerror(errno));
+    {
+        perror("msync");
+        ErrorF("msync failed, %s", strerror(errno));
+    }
+}
+
+/* this flushes any changes to the screen out to the mmapped file */
+static void
+vfbBlockHandler(void *blockData, void *timeout)
+{
+    vfbScreenInfoPtr pvfb = blockData;
+    char *fb = pvfb->pfbMemory;
+    RegionPtr pRegion;
+    BoxPtr pBox;
+    int nBox, y1, y2;
+
+    if (!pvfb->pXWDHeader)
+        return;
+
+    /* no damage tracking (yet), flush everything */
+    if (!pvfb->pDamage) {
+        vfbSyncRange(pvfb, (char *) pvfb->pXWDHeader,
+                     (char *) pvfb->pXWDHeader + pvfb->sizeInBytes);
+        return;
+    }
+
+    if (pvfb->headerDirty) {
+        vfbSyncRange(pvfb, (char *) pvfb->pXWDHeader, fb);
+        pvfb->headerDirty = FALSE;
+    }
+
+    pRegion = DamageRegion(pvfb->pDamage);
+    if (!RegionNotEmpty(pRegion))
+        return;
+
+    /* boxes come sorted by y; flush whole rows, merging overlapping bands */
+    pBox = RegionRects(pRegion);
+    nBox = RegionNumRects(pRegion);
+    y1 = pBox->y1;
+    y2 = pBox->y2;
+    while (--nBox >= 0) {
+        if (pBox->y1 > y2) {
+            vfbSyncRange(pvfb, fb + y1 * pvfb->paddedBytesWidth,
+                         fb + y2 * pvfb->paddedBytesWidth);
+            y1 = pBox->y1;
         }
+        y2 = max(y2, pBox->y2);
+        pBox++;
     }
+    vfbSyncRange(pvfb, fb + y1 * pvfb->paddedBytesWidth,
+                 fb + y2 * pvfb->paddedBytesWidth);
+
+    DamageEmpty(pvfb->pDamage);
 }
 
 static void
@@ -597,7 +699,7 @@ vfbAllocateMmappedFramebuffer(vfbScreenInfoPtr pvfb)
     }
 
     if (!RegisterBlockAndWakeupHandlers(vfbBlockHandler, vfbWakeupHandler,
-                                        NULL)) {
+                                        pvfb)) {
         pvfb->pXWDHeader = NULL;
     }
 }
@@ -759,6 +861,41 @@ vfbWriteXWDFileHeader(ScreenPtr pScreen)
     }
 }
 
+static Bool
+vfbCreateScreenResources(ScreenPtr pScreen)
+{
+    vfbScreenInfoPtr pvfb = &vfbScreens[pScreen->myNum];
+    Bool ret;
+
+    pScreen->CreateScreenResources = pvfb->createScreenResources;
+    ret = pScreen->CreateScreenResources(pScreen);
+    pScreen->CreateScreenResources = vfbCreateScreenResources;
+    if (!ret)
+        return FALSE;
+
+#ifdef HAVE_MMAP
+    if (fbmemtype == MMAPPED_FILE_FB) {
+        /* if this fails, the block handler just keeps flushing everything */
+        pvfb->pDamage = DamageCreate(NULL, NULL, DamageReportNone, TRUE,
+                                     pScreen, pScreen);
+        if (pvfb->pDamage)
+            DamageRegister(&pScreen->GetScreenPixmap(pScreen)->drawable,
+                           pvfb->pDamage);
+        pvfb->headerDirty = TRUE;
+    }
+#endif
+
+#ifdef CONFIG_MITSHM
+    if (vfbRingSlots) {
+        pvfb->ring = vfbRingCreate(pScreen, vfbRingSlots, vfbRingFps);
+        if (!pvfb->ring)
+            return FALSE;
+    }
+#endif
+
+    return TRUE;
+}
+
 static Bool
 vfbCursorOffScreen(ScreenPtr *ppScreen, int *x, int *y)
 {
@@ -783,6 +920,19 @@ vfbCloseScreen(ScreenPtr pScreen)
 
     pScreen->CloseScreen = pvfb->closeScreen;
 
+    pScreen->CreateScreenResources = pvfb->createScreenResources;
+
+#ifdef HAVE_MMAP
+    if (pvfb->pDamage) {
+        DamageDestroy(pvfb->pDamage);
+        pvfb->pDamage = NULL;
+    }
+#endif
+#ifdef CONFIG_MITSHM
+    vfbRingDestroy(pvfb->ring);
+    pvfb->ring = NULL;
+#endif
+
     /*
      * fb overwrites miCloseScreen, so do this here
      */
@@ -1042,6 +1192,9 @@ vfbScreenInit(ScreenPtr pScreen, int argc, char **argv)
     pvfb->closeScreen = pScreen->CloseScreen;
     pScreen->CloseScreen = vfbCloseScreen;
 
+    pvfb->createScreenResources = pScreen->CreateScreenResources;
+    pScreen->CreateScreenResources = vfbCreateScreenResources;
+
     return ret;
 
 }                               /* end vfbScreenInit */
@@ -0,0 +1,235 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Publish completed frames of an Xvfb screen into a shared memory ring,
+ * so that capture tools can read consistent frames (and what changed in
+ * them) instead of polling and diffing the live framebuffer.
+ *
+ * Frames are driven by damage on the screen pixmap: the first damage after
+ * a frame was published arms a timer, and when it fires everything drawn
+ * since is published as one frame.  So an idle server publishes nothing,
+ * and a busy one no more than the configured rate.
+ */
+#include <dix-config.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#include "misc.h"
+#include "os.h"
+#include "scrnintstr.h"
+#include "pixmapstr.h"
+#include "regionstr.h"
+#include "damage.h"
+
+#include "vfbring.h"
+
+struct _vfbRing {
+    ScreenPtr pScreen;
+    DamagePtr pDamage;
+    OsTimerPtr timer;
+    Bool armed;
+    CARD32 interval;            /* ms between frames */
+    CARD32 lastPublish;
+    int shmid;
+    int nslots;
+    vfbRingHeader *header;
+    char *pixels;               /* slot 0 */
+    RegionRec *pending;         /* per slot, what it is missing */
+};
+
+static void
+vfbRingCopyRegion(PixmapPtr pPixmap, char *dst, RegionPtr pRegion)
+{
+    int bpp = pPixmap->drawable.bitsPerPixel;
+    int stride = pPixmap->devKind;
+    char *src = pPixmap->devPrivate.ptr;
+    BoxPtr pBox = RegionRects(pRegion);
+    int nBox = RegionNumRects(pRegion);
+
+    while (--nBox >= 0) {
+        int x1 = (pBox->x1 * bpp) / 8;
+        int x2 = (pBox->x2 * bpp + 7) / 8;
+
+        for (int y = pBox->y1; y < pBox->y2; y++)
+            memcpy(dst + y * stride + x1, src + y * stride + x1, x2 - x1);
+        pBox++;
+    }
+}
+
+static void
+vfbRingPublish(vfbRingPtr ring)
+{
+    vfbRingHeader *header = ring->header;
+    PixmapPtr pPixmap = ring->pScreen->GetScreenPixmap(ring->pScreen);
+    RegionPtr pDamage = DamageRegion(ring->pDamage);
+    uint64_t frame = header->frame + 1;
+    int idx = (frame - 1) % ring->nslots;
+    vfbRingSlot *slot = &header->slots[idx];
+    int nrects = RegionNumRects(pDamage);
+
+    /* every slot falls behind by what was drawn; the one we're about to
+     * reuse catches up on everything it missed while others were written */
+    for (int i = 0; i < ring->nslots; i++)
+        RegionUnion(&ring->pending[i], &ring->pending[i], pDamage);
+
+    __atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    vfbRingCopyRegion(pPixmap, ring->pixels + idx * header->slot_size,
+                      &ring->pending[idx]);
+    RegionEmpty(&ring->pending[idx]);
+
+    if (nrects > VFB_RING_MAX_RECTS) {
+        BoxPtr pExtents = RegionExtents(pDamage);
+
+        slot->rects[0] = (vfbRingRect) {
+            pExtents->x1, pExtents->y1, pExtents->x2, pExtents->y2
+        };
+        nrects = 1;
+    }
+    else {
+        BoxPtr pBox = RegionRects(pDamage);
+
+        for (int i = 0; i < nrects; i++, pBox++)
+            slot->rects[i] = (vfbRingRect) {
+                pBox->x1, pBox->y1, pBox->x2, pBox->y2
+            };
+    }
+    slot->nrects = nrects;
+    slot->frame = frame;
+    slot->usec = GetTimeInMicros();
+
+    __atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&header->frame, frame, __ATOMIC_RELEASE);
+
+    DamageEmpty(ring->pDamage);
+}
+
+static CARD32
+vfbRingTimerNotify(OsTimerPtr timer, CARD32 now, void *arg)
+{
+    vfbRingPtr ring = arg;
+
+    ring->armed = FALSE;
+    ring->lastPublish = now;
+    if (RegionNotEmpty(DamageRegion(ring->pDamage)))
+        vfbRingPublish(ring);
+    return 0;
+}
+
+static void
+vfbRingDamageReport(DamagePtr pDamage, RegionPtr pRegion, void *closure)
+{
+    vfbRingPtr ring = closure;
+    CARD32 elapsed;
+
+    if (ring->armed)
+        return;
+
+    elapsed = GetTimeInMillis() - ring->lastPublish;
+    ring->timer = TimerSet(ring->timer, 0,
+                           elapsed < ring->interval ?
+                           ring->interval - elapsed : 1,
+                           vfbRingTimerNotify, ring);
+    ring->armed = TRUE;
+}
+
+vfbRingPtr
+vfbRingCreate(ScreenPtr pScreen, int nslots, int fps)
+{
+    PixmapPtr pPixmap = pScreen->GetScreenPixmap(pScreen);
+    BoxRec box = {
+        0, 0, pPixmap->drawable.width, pPixmap->drawable.height
+    };
+    size_t slot_size = (size_t) pPixmap->devKind * pPixmap->drawable.height;
+    size_t header_size = sizeof(vfbRingHeader) + nslots * sizeof(vfbRingSlot);
+    vfbRingHeader *header;
+    vfbRingPtr ring;
+
+    /* keep the pixels nicely aligned for readers */
+    header_size = (header_size + 63) & ~(size_t) 63;
+
+    ring = calloc(1, sizeof(*ring));
+    if (!ring)
+        return NULL;
+    ring->pScreen = pScreen;
+    ring->shmid = -1;
+    ring->nslots = nslots;
+    ring->interval = max(1000 / fps, 1);
+    ring->lastPublish = GetTimeInMillis() - ring->interval;
+
+    ring->pending = calloc(nslots, sizeof(RegionRec));
+    if (!ring->pending)
+        goto bail;
+    /* the slots start out empty, so the first frame each gets is a full one */
+    for (int i = 0; i < nslots; i++)
+        RegionInit(&ring->pending[i], &box, 1);
+
+    /* the whole screen history is in there, keep it to the server's user */
+    ring->shmid = shmget(IPC_PRIVATE, header_size + nslots * slot_size,
+                         IPC_CREAT | 0600);
+    if (ring->shmid < 0) {
+        ErrorF("shmget %zu bytes for frame ring failed, %s\n",
+               header_size + nslots * slot_size, strerror(errno));
+        goto bail;
+    }
+
+    header = shmat(ring->shmid, 0, 0);
+    if (-1 == (long) header) {
+        ErrorF("shmat for frame ring failed, %s\n", strerror(errno));
+        goto bail;
+    }
+    ring->header = header;
+    ring->pixels = (char *) header + header_size;
+
+    header->magic = VFB_RING_MAGIC;
+    header->version = VFB_RING_VERSION;
+    header->width = pPixmap->drawable.width;
+    header->height = pPixmap->drawable.height;
+    header->stride = pPixmap->devKind;
+    header->bits_per_pixel = pPixmap->drawable.bitsPerPixel;
+    header->depth = pPixmap->drawable.depth;
+    header->nslots = nslots;
+    header->slot_offset = header_size;
+    header->slot_size = slot_size;
+    header->frame = 0;
+
+    ring->pDamage = DamageCreate(vfbRingDamageReport, NULL,
+                                 DamageReportNonEmpty, TRUE, pScreen, ring);
+    if (!ring->pDamage)
+        goto bail;
+    DamageRegister(&pPixmap->drawable, ring->pDamage);
+
+    ErrorF("screen %d frame ring shmid %d\n", pScreen->myNum, ring->shmid);
+
+    return ring;
+
+ bail:
+    vfbRingDestroy(ring);
+    return NULL;
+}
+
+void
+vfbRingDestroy(vfbRingPtr ring)
+{
+    if (!ring)
+        return;
+
+    TimerFree(ring->timer);
+    if (ring->pDamage)
+        DamageDestroy(ring->pDamage);
+    if (ring->header)
+        shmdt(ring->header);
+    /* readers still attached keep the segment until they detach */
+    if (ring->shmid >= 0)
+        shmctl(ring->shmid, IPC_RMID, NULL);
+    if (ring->pending) {
+        for (int i = 0; i < ring->nslots; i++)
+            RegionUninit(&ring->pending[i]);
+        free(ring->pending);
+    }
+    free(ring);
+}
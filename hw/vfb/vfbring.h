@@ -0,0 +1,60 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Frame ring published by Xvfb -fbring.
+ *
+ * The shared memory segment starts with a vfbRingHeader, followed by
+ * nslots slot descriptors and then nslots complete copies of the screen,
+ * each slot_size bytes apart starting at slot_offset.  Frame n (counting
+ * from 1) lives in slot (n - 1) % nslots; header->frame is the last frame
+ * that was completely written.
+ *
+ * A slot's seq is odd while the server writes to it.  Readers copy what
+ * they need and then check that seq is even and hasn't changed; if it has,
+ * the server caught up with them and they should move on to a newer frame.
+ */
+#ifndef _XSERVER_HW_VFB_RING_H
+#define _XSERVER_HW_VFB_RING_H
+
+#include <stdint.h>
+
+#include "screenint.h"
+
+#define VFB_RING_MAGIC          0x52667658      /* "XvfR" */
+#define VFB_RING_VERSION        1
+#define VFB_RING_MAX_RECTS      32
+
+typedef struct {
+    int16_t x1, y1, x2, y2;
+} vfbRingRect;
+
+typedef struct {
+    uint64_t seq;
+    uint64_t frame;             /* frame number held in this slot */
+    uint64_t usec;              /* server time the frame was published */
+    uint32_t nrects;            /* area changed since the previous frame; */
+    uint32_t pad;               /* just the extents if it doesn't fit */
+    vfbRingRect rects[VFB_RING_MAX_RECTS];
+} vfbRingSlot;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;            /* bytes per line */
+    uint32_t bits_per_pixel;
+    uint32_t depth;
+    uint32_t nslots;
+    uint64_t slot_offset;
+    uint64_t slot_size;
+    uint64_t frame;             /* last completed frame, 0 if none yet */
+    vfbRingSlot slots[];
+} vfbRingHeader;
+
+/* server side */
+typedef struct _vfbRing *vfbRingPtr;
+
+vfbRingPtr vfbRingCreate(ScreenPtr pScreen, int nslots, int fps);
+void vfbRingDestroy(vfbRingPtr ring);
+
+#endif /* _XSERVER_HW_VFB_RING_H */
@@ -46,6 +46,7 @@ char *xnestWindowName = NULL;
 int xnestNumScreens = 0;
 Bool xnestDoDirectColormaps = FALSE;
 xcb_window_t xnestParentWindow = 0;
+Bool xnestPixmapShadow = FALSE;
 
 int
 ddxProcessArgument(int argc, char *argv[], int i)
@@ -164,6 +165,10 @@ ddxProcessArgument(int argc, char *argv[], int i)
         xnestDoDirectColormaps = TRUE;
         return 1;
     }
+    if (!strcmp(argv[i], "-pixmapshadow")) {
+        xnestPixmapShadow = TRUE;
+        return 1;
+    }
     if (!strcmp(argv[i], "-parent")) {
         if (++i < argc) {
             xnestParentWindow = (XID) strtol(argv[i], (char **) NULL, 0);
@@ -185,4 +190,5 @@ ddxUseMsg(void)
     ErrorF("-name string           window name\n");
     ErrorF("-scrns int             number of screens to generate\n");
     ErrorF("-install               install colormaps directly\n");
+    ErrorF("-pixmapshadow          answer GetImage on pixmaps locally if possible\n");
 }
@@ -34,5 +34,6 @@ extern char *xnestWindowName;
 extern int xnestNumScreens;
 extern Bool xnestDoDirectColormaps;
 extern xcb_window_t xnestParentWindow;
+extern Bool xnestPixmapShadow;
 
 #endif                          /* XNESTARGS_H */
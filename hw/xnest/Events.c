@@ -79,6 +79,17 @@ xnest_handle_event(xcb_generic_event_t *event)
         return;
 
     switch (event->response_type & ~0x80) {
+        case 0:
+        {
+            /* errors for requests nobody waits on end up here */
+            EVTYPE(xcb_generic_error_t);
+            LogMessageVerb(X_WARNING, 1,
+                           "xnest: upstream error %d for request %d.%d "
+                           "(sequence %d)\n", ev->error_code,
+                           ev->major_code, ev->minor_code, ev->sequence);
+            break;
+        }
+
         case KeyPress:
         {
             EVTYPE(xcb_key_press_event_t);
@@ -83,23 +83,26 @@ xnestCreateGC(GCPtr pGC)
 
     pGC->miTranslate = 1;
 
+    /*
+     * Graphics exposures are left off upstream unless a copy needs them,
+     * see xnestCopyArea().
+     */
+    uint32_t exposures = FALSE;
+
     xnestGCPriv(pGC)->gc = xcb_generate_id(xnestUpstreamInfo.conn);
+    xnestGCPriv(pGC)->pending = 0;
+    xnestGCPriv(pGC)->exposures = FALSE;
     xcb_create_gc(xnestUpstreamInfo.conn,
                   xnestGCPriv(pGC)->gc,
                   xnestDefaultDrawables[pGC->depth],
-                  0,
-                  NULL);
+                  XCB_GC_GRAPHICS_EXPOSURES,
+                  &exposures);
 
     return TRUE;
 }
 
-void
-xnestValidateGC(GCPtr pGC, unsigned long changes, DrawablePtr pDrawable)
-{
-}
-
-void
-xnestChangeGC(GCPtr pGC, unsigned long mask)
+static void
+xnestSendGC(GCPtr pGC, unsigned long mask)
 {
     xcb_params_gc_t values;
 
@@ -155,8 +158,8 @@ xnestChangeGC(GCPtr pGC, unsigned long mask)
     if (mask & GCSubwindowMode)
         values.subwindow_mode = pGC->subWindowMode;
 
-    if (mask & GCGraphicsExposures)
-        values.graphics_exposures = pGC->graphicsExposures;
+    if (mask & GCGraphicsExposures)     /* see xnestSetGCExposures() */
+        mask &= ~GCGraphicsExposures;
 
     if (mask & GCClipXOrigin)
         values.clip_originX = pGC->clipOrg.x;
@@ -189,9 +192,57 @@ xnestChangeGC(GCPtr pGC, unsigned long mask)
                           &values);
 }
 
+/*
+ * GC changes are only sent upstream when the GC is next used for drawing,
+ * so a client changing several attributes in a row, or a GC that's changed
+ * and changed back, costs one request at most.
+ */
+void
+xnestValidateGC(GCPtr pGC, unsigned long changes, DrawablePtr pDrawable)
+{
+    xnestPrivGC *priv = xnestGCPriv(pGC);
+
+    if (priv->pending) {
+        xnestSendGC(pGC, priv->pending);
+        priv->pending = 0;
+    }
+}
+
+void
+xnestChangeGC(GCPtr pGC, unsigned long mask)
+{
+    xnestGCPriv(pGC)->pending |= mask;
+}
+
+void
+xnestSetGCExposures(GCPtr pGC, Bool exposures)
+{
+    xnestPrivGC *priv = xnestGCPriv(pGC);
+    uint32_t value = exposures;
+
+    if (priv->exposures == exposures)
+        return;
+    xcb_change_gc(xnestUpstreamInfo.conn, priv->gc,
+                  XCB_GC_GRAPHICS_EXPOSURES, &value);
+    priv->exposures = exposures;
+}
+
 void
 xnestCopyGC(GCPtr pGCSrc, unsigned long mask, GCPtr pGCDst)
 {
+    xnestPrivGC *src = xnestGCPriv(pGCSrc);
+    xnestPrivGC *dst = xnestGCPriv(pGCDst);
+
+    /* the copy has to see the source as it is now, and overrides
+     * whatever the destination still had to send for these */
+    if (src->pending & mask) {
+        xnestSendGC(pGCSrc, src->pending);
+        src->pending = 0;
+    }
+    dst->pending &= ~mask;
+    if (mask & GCGraphicsExposures)
+        dst->exposures = src->exposures;
+
     xcb_copy_gc(xnestUpstreamInfo.conn,
                 xnestGC(pGCSrc),
                 xnestGC(pGCDst),
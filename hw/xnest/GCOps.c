@@ -91,10 +91,27 @@ xnestQueryBestSize(int class, unsigned short *pWidth, unsigned short *pHeight,
     free(reply);
 }
 
+static Bool
+xnestAllPlanes(unsigned long planeMask, int depth)
+{
+    unsigned long all = depth >= 32 ? 0xffffffff : (1UL << depth) - 1;
+
+    return (planeMask & all) == all;
+}
+
 void
 xnestPutImage(DrawablePtr pDrawable, GCPtr pGC, int depth, int x, int y,
               int w, int h, int leftPad, int format, char *pImage)
 {
+    if (format == XCB_IMAGE_FORMAT_Z_PIXMAP && pGC->alu == GXcopy &&
+        !pGC->clientClip && xnestAllPlanes(pGC->planemask, depth))
+        xnestPixmapShadowPut(pDrawable, x, y, w, h, pImage);
+    else {
+        BoxRec box = { x, y, x + w, y + h };
+
+        xnestPixmapShadowDamage(pDrawable, &box);
+    }
+
     xcb_put_image(xnestUpstreamInfo.conn,
                   format,
                   xnestDrawable(pDrawable),
@@ -114,6 +131,12 @@ void
 xnestGetImage(DrawablePtr pDrawable, int x, int y, int w, int h,
               unsigned int format, unsigned long planeMask, char *pImage)
 {
+    Bool allPlanes = format == XCB_IMAGE_FORMAT_Z_PIXMAP &&
+        xnestAllPlanes(planeMask, pDrawable->depth);
+
+    if (allPlanes && xnestPixmapShadowGet(pDrawable, x, y, w, h, pImage))
+        return;
+
     xcb_generic_error_t * err = NULL;
     xcb_get_image_reply_t *reply= xcb_get_image_reply(
         xnestUpstreamInfo.conn,
@@ -139,6 +162,10 @@ xnestGetImage(DrawablePtr pDrawable, int x, int y, int w, int h,
 
     memmove(pImage, xcb_get_image_data(reply), xcb_get_image_data_length(reply));
     free(reply);
+
+    /* now we know what's there, too */
+    if (allPlanes)
+        xnestPixmapShadowPut(pDrawable, x, y, w, h, pImage);
 }
 
 static RegionPtr
@@ -201,18 +228,42 @@ xnestBitBlitHelper(GCPtr pGC)
     }
 }
 
+/*
+ * A copy from inside a pixmap can't expose anything, so there's no need to
+ * have the upstream server tell us so and wait for it.  Only copies from
+ * windows, or from outside a pixmap, ask upstream for graphics exposures.
+ */
+static Bool
+xnestCopyNeedsExposures(DrawablePtr pSrcDrawable, GCPtr pGC,
+                        int srcx, int srcy, int width, int height)
+{
+    if (!pGC->graphicsExposures)
+        return FALSE;
+    if (pSrcDrawable->type != DRAWABLE_PIXMAP)
+        return TRUE;
+    return srcx < 0 || srcy < 0 ||
+        srcx + width > pSrcDrawable->width ||
+        srcy + height > pSrcDrawable->height;
+}
+
 RegionPtr
 xnestCopyArea(DrawablePtr pSrcDrawable, DrawablePtr pDstDrawable,
               GCPtr pGC, int srcx, int srcy, int width, int height,
               int dstx, int dsty)
 {
+    BoxRec box = { dstx, dsty, dstx + width, dsty + height };
+    Bool exposures = xnestCopyNeedsExposures(pSrcDrawable, pGC,
+                                             srcx, srcy, width, height);
+
+    xnestPixmapShadowDamage(pDstDrawable, &box);
+    xnestSetGCExposures(pGC, exposures);
     xcb_copy_area(xnestUpstreamInfo.conn,
                   xnestDrawable(pSrcDrawable),
                   xnestDrawable(pDstDrawable),
                   xnest_upstream_gc(pGC),
                   srcx, srcy, dstx, dsty, width, height);
 
-    return xnestBitBlitHelper(pGC);
+    return exposures ? xnestBitBlitHelper(pGC) : NullRegion;
 }
 
 RegionPtr
@@ -220,19 +271,27 @@ xnestCopyPlane(DrawablePtr pSrcDrawable, DrawablePtr pDstDrawable,
                GCPtr pGC, int srcx, int srcy, int width, int height,
                int dstx, int dsty, unsigned long plane)
 {
+    BoxRec box = { dstx, dsty, dstx + width, dsty + height };
+    Bool exposures = xnestCopyNeedsExposures(pSrcDrawable, pGC,
+                                             srcx, srcy, width, height);
+
+    xnestPixmapShadowDamage(pDstDrawable, &box);
+    xnestSetGCExposures(pGC, exposures);
     xcb_copy_plane(xnestUpstreamInfo.conn,
                    xnestDrawable(pSrcDrawable),
                    xnestDrawable(pDstDrawable),
                    xnest_upstream_gc(pGC),
                    srcx, srcy, dstx, dsty, width, height, plane);
 
-    return xnestBitBlitHelper(pGC);
+    return exposures ? xnestBitBlitHelper(pGC) : NullRegion;
 }
 
 void
 xnestPolyPoint(DrawablePtr pDrawable, GCPtr pGC, int mode, int nPoints,
                DDXPointPtr pPoints)
 {
+    xnestPixmapShadowDamage(pDrawable, NULL);
+
     /* xPoint and xcb_segment_t are defined in the same way, both matching
        the protocol layout, so we can directly typecast them */
     xcb_poly_point(xnestUpstreamInfo.conn,
@@ -247,6 +306,8 @@ void
 xnestPolylines(DrawablePtr pDrawable, GCPtr pGC, int mode, int nPoints,
                DDXPointPtr pPoints)
 {
+    xnestPixmapShadowDamage(pDrawable, NULL);
+
     /* xPoint and xcb_segment_t are defined in the same way, both matching
        the protocol layout, so we can directly typecast them */
     xcb_poly_line(xnestUpstreamInfo.conn,
@@ -261,6 +322,8 @@ void
 xnestPolySegment(DrawablePtr pDrawable, GCPtr pGC, int nSegments,
                  xSegment * pSegments)
 {
+    xnestPixmapShadowDamage(pDrawable, NULL);
+
     /* xSegment and xcb_segment_t are defined in the same way, both matching
        the protocol layout, so we can directly typecast them */
     xcb_poly_segment(xnestUpstreamInfo.conn,
@@ -274,6 +337,8 @@ void
 xnestPolyRectangle(DrawablePtr pDrawable, GCPtr pGC, int nRectangles,
                    xRectangle *pRectangles)
 {
+    xnestPixmapShadowDamage(pDrawable, NULL);
+
     /* xRectangle and xcb_rectangle_t are defined in the same way, both matching
        the protocol layout, so we can directly typecast them */
     xcb_poly_rectangle(xnestUpstreamInfo.conn,
@@ -286,6 +351,8 @@ xnestPolyRectangle(DrawablePtr pDrawable, GCPtr pGC, int nRectangles,
 void
 xnestPolyArc(DrawablePtr pDrawable, GCPtr pGC, int nArcs, xArc * pArcs)
 {
+    xnestPixmapShadowDamage(pDrawable, NULL);
+
     /* xArc and xcb_arc_t are defined in the same way, both matching
        the protocol layout, so we can directly typecast them */
     xcb_poly_arc(xnestUpstreamInfo.conn,
@@ -299,6 +366,8 @@ void
 xnestFillPolygon(DrawablePtr pDrawable, GCPtr pGC, int shape, int mode,
                  int nPoints, DDXPointPtr pPoints)
 {
+    xnestPixmapShadowDamage(pDrawable, NULL);
+
     /* xPoint and xcb_segment_t are defined in the same way, both matching
        the protocol layout, so we can directly typecast them */
     xcb_fill_poly(xnestUpstreamInfo.conn,
@@ -314,6 +383,8 @@ void
 xnestPolyFillRect(DrawablePtr pDrawable, GCPtr pGC, int nRectangles,
                   xRectangle *pRectangles)
 {
+    xnestPixmapShadowDamage(pDrawable, NULL);
+
     /* xRectangle and xcb_rectangle_t are defined in the same way, both matching
        the protocol layout, so we can directly typecast them */
     xcb_poly_fill_rectangle(xnestUpstreamInfo.conn,
@@ -326,6 +397,8 @@ xnestPolyFillRect(DrawablePtr pDrawable, GCPtr pGC, int nRectangles,
 void
 xnestPolyFillArc(DrawablePtr pDrawable, GCPtr pGC, int nArcs, xArc * pArcs)
 {
+    xnestPixmapShadowDamage(pDrawable, NULL);
+
     /* xArc and xcb_arc_t are defined in the same way, both matching
        the protocol layout, so we can directly typecast them */
     xcb_poly_fill_arc(xnestUpstreamInfo.conn,
@@ -348,6 +421,7 @@ xnestPolyText8(DrawablePtr pDrawable, GCPtr pGC, int x, int y, int count,
     elt->delta = 0;
     memcpy(buffer+2, string, count);
 
+    xnestPixmapShadowDamage(pDrawable, NULL);
     xcb_poly_text_8(xnestUpstreamInfo.conn,
                     xnestDrawable(pDrawable),
                     xnest_upstream_gc(pGC),
@@ -374,6 +448,7 @@ xnestPolyText16(DrawablePtr pDrawable, GCPtr pGC, int x, int y, int count,
     elt->delta = 0;
     memcpy(buffer+2, string, count*2);
 
+    xnestPixmapShadowDamage(pDrawable, NULL);
     xcb_poly_text_16(xnestUpstreamInfo.conn,
                      xnestDrawable(pDrawable),
                      xnest_upstream_gc(pGC),
@@ -391,6 +466,7 @@ void
 xnestImageText8(DrawablePtr pDrawable, GCPtr pGC, int x, int y, int count,
                 char *string)
 {
+    xnestPixmapShadowDamage(pDrawable, NULL);
     xcb_image_text_8(xnestUpstreamInfo.conn,
                      count,
                      xnestDrawable(pDrawable),
@@ -404,6 +480,7 @@ void
 xnestImageText16(DrawablePtr pDrawable, GCPtr pGC, int x, int y, int count,
                  unsigned short *string)
 {
+    xnestPixmapShadowDamage(pDrawable, NULL);
     xcb_image_text_16(xnestUpstreamInfo.conn,
                       count,
                       xnestDrawable(pDrawable),
@@ -435,6 +512,10 @@ xnestPushPixels(GCPtr pGC, PixmapPtr pBitmap, DrawablePtr pDst,
 {
     /* only works for solid bitmaps */
     if (pGC->fillStyle == FillSolid) {
+        BoxRec box = { x, y, x + width, y + height };
+
+        xnestPixmapShadowDamage(pDst, &box);
+
         xcb_params_gc_t params = {
             .fill_style = XCB_FILL_STYLE_STIPPLED,
             .tile_stipple_origin_x = x,
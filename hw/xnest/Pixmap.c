@@ -29,6 +29,7 @@ is" without express or implied warranty.
 
 #include "Display.h"
 #include "Screen.h"
+#include "Args.h"
 #include "XNPixmap.h"
 
 DevPrivateKeyRec xnestPixmapPrivateKeyRec;
@@ -52,6 +53,7 @@ xnestCreatePixmap(ScreenPtr pScreen, int width, int height, int depth,
     pPixmap->refcnt = 1;
     pPixmap->devKind = PixmapBytePad(width, depth);
     pPixmap->usage_hint = usage_hint;
+    RegionNull(&xnestPixmapPriv(pPixmap)->shadowValid);
     if (width && height) {
         uint32_t pixmap = xcb_generate_id(xnestUpstreamInfo.conn);
         xcb_create_pixmap(xnestUpstreamInfo.conn, depth, pixmap,
@@ -69,6 +71,8 @@ xnestDestroyPixmap(PixmapPtr pPixmap)
 {
     if (--pPixmap->refcnt)
         return TRUE;
+    free(xnestPixmapPriv(pPixmap)->shadow);
+    RegionUninit(&xnestPixmapPriv(pPixmap)->shadowValid);
     xcb_free_pixmap(xnestUpstreamInfo.conn, xnestPixmap(pPixmap));
     FreePixmap(pPixmap);
     return TRUE;
@@ -86,6 +90,11 @@ xnestModifyPixmapHeader(PixmapPtr pPixmap, int width, int height, int depth,
         xnestPixmapPriv(pPixmap)->pixmap = pixmap;
   }
 
+  /* the layout may change, start over */
+  free(xnestPixmapPriv(pPixmap)->shadow);
+  xnestPixmapPriv(pPixmap)->shadow = NULL;
+  RegionEmpty(&xnestPixmapPriv(pPixmap)->shadowValid);
+
   return miModifyPixmapHeader(pPixmap, width, height, depth,
                               bitsPerPixel, devKind, pPixData);
 }
@@ -176,3 +185,103 @@ xnestPixmapToRegion(PixmapPtr pPixmap)
 
     return pReg;
 }
+
+/*
+ * With -pixmapshadow, keep a local copy of pixmap contents that came from
+ * or went to the upstream server as whole ZPixmap images, so GetImage can
+ * be answered without a round trip.  Any other drawing is only forwarded,
+ * so it just marks what it may have touched as unknown again.
+ */
+static Bool
+xnestPixmapShadowable(DrawablePtr pDrawable)
+{
+    return xnestPixmapShadow && pDrawable->type == DRAWABLE_PIXMAP &&
+        BitsPerPixel(pDrawable->depth) >= 8;
+}
+
+void
+xnestPixmapShadowDamage(DrawablePtr pDrawable, const BoxRec *pBox)
+{
+    xnestPrivPixmap *priv;
+
+    if (pDrawable->type != DRAWABLE_PIXMAP)
+        return;
+    priv = xnestPixmapPriv((PixmapPtr) pDrawable);
+    if (!priv->shadow || !RegionNotEmpty(&priv->shadowValid))
+        return;
+
+    if (pBox) {
+        RegionRec damage;
+
+        RegionInit(&damage, (BoxPtr) pBox, 1);
+        RegionSubtract(&priv->shadowValid, &priv->shadowValid, &damage);
+        RegionUninit(&damage);
+    }
+    else
+        RegionEmpty(&priv->shadowValid);
+}
+
+void
+xnestPixmapShadowPut(DrawablePtr pDrawable, int x, int y, int w, int h,
+                     const char *pImage)
+{
+    PixmapPtr pPixmap = (PixmapPtr) pDrawable;
+    xnestPrivPixmap *priv;
+    int bytes = BitsPerPixel(pDrawable->depth) / 8;
+    int stride = PixmapBytePad(w, pDrawable->depth);
+    BoxRec box = { x, y, x + w, y + h };
+    RegionRec valid;
+
+    if (!xnestPixmapShadowable(pDrawable))
+        return;
+    priv = xnestPixmapPriv(pPixmap);
+
+    /* only keep what lands inside the pixmap */
+    if (box.x1 < 0 || box.y1 < 0 ||
+        box.x2 > pDrawable->width || box.y2 > pDrawable->height) {
+        xnestPixmapShadowDamage(pDrawable, &box);
+        return;
+    }
+
+    if (!priv->shadow) {
+        priv->shadow = calloc(pDrawable->height, pPixmap->devKind);
+        if (!priv->shadow)
+            return;
+    }
+
+    for (int row = 0; row < h; row++)
+        memcpy(priv->shadow + (y + row) * pPixmap->devKind + x * bytes,
+               pImage + row * stride, w * bytes);
+
+    RegionInit(&valid, &box, 1);
+    RegionUnion(&priv->shadowValid, &priv->shadowValid, &valid);
+    RegionUninit(&valid);
+}
+
+Bool
+xnestPixmapShadowGet(DrawablePtr pDrawable, int x, int y, int w, int h,
+                     char *pImage)
+{
+    PixmapPtr pPixmap = (PixmapPtr) pDrawable;
+    xnestPrivPixmap *priv;
+    int bytes = BitsPerPixel(pDrawable->depth) / 8;
+    int stride = PixmapBytePad(w, pDrawable->depth);
+    BoxRec box = { x, y, x + w, y + h };
+
+    if (!xnestPixmapShadowable(pDrawable))
+        return FALSE;
+    priv = xnestPixmapPriv(pPixmap);
+    if (!priv->shadow ||
+        RegionContainsRect(&priv->shadowValid, &box) != rgnIN)
+        return FALSE;
+
+    for (int row = 0; row < h; row++) {
+        memcpy(pImage + row * stride,
+               priv->shadow + (y + row) * pPixmap->devKind + x * bytes,
+               w * bytes);
+        /* don't hand out stale memory in the padding */
+        memset(pImage + row * stride + w * bytes, 0, stride - w * bytes);
+    }
+
+    return TRUE;
+}
@@ -459,19 +459,19 @@ breakout:
 
         const size_t windowNameLen = strlen(xnestWindowName);
 
-        xcb_icccm_set_wm_name_checked(xnestUpstreamInfo.conn,
-                                      xnestDefaultWindows[pScreen->myNum],
-                                      XCB_ATOM_STRING,
-                                      8,
-                                      windowNameLen,
-                                      xnestWindowName);
-
-        xcb_icccm_set_wm_icon_name_checked(xnestUpstreamInfo.conn,
-                                           xnestDefaultWindows[pScreen->myNum],
-                                           XCB_ATOM_STRING,
-                                           8,
-                                           windowNameLen,
-                                           xnestWindowName);
+        xcb_icccm_set_wm_name(xnestUpstreamInfo.conn,
+                              xnestDefaultWindows[pScreen->myNum],
+                              XCB_ATOM_STRING,
+                              8,
+                              windowNameLen,
+                              xnestWindowName);
+
+        xcb_icccm_set_wm_icon_name(xnestUpstreamInfo.conn,
+                                   xnestDefaultWindows[pScreen->myNum],
+                                   XCB_ATOM_STRING,
+                                   8,
+                                   windowNameLen,
+                                   xnestWindowName);
 
         xnest_set_command(xnestUpstreamInfo.conn,
                           xnestDefaultWindows[pScreen->myNum],
@@ -482,9 +482,9 @@ breakout:
             .flags = XCB_ICCCM_WM_HINT_ICON_PIXMAP,
         };
 
-        xcb_icccm_set_wm_hints_checked(xnestUpstreamInfo.conn,
-                                       xnestDefaultWindows[pScreen->myNum],
-                                       &wmhints);
+        xcb_icccm_set_wm_hints(xnestUpstreamInfo.conn,
+                               xnestDefaultWindows[pScreen->myNum],
+                               &wmhints);
 
         xcb_map_window(xnestUpstreamInfo.conn, xnestDefaultWindows[pScreen->myNum]);
 
@@ -22,6 +22,8 @@ is" without express or implied warranty.
 
 typedef struct {
     uint32_t gc;
+    unsigned long pending;      /* changes not sent upstream yet */
+    Bool exposures;             /* upstream graphics_exposures */
 } xnestPrivGC;
 
 extern DevPrivateKeyRec xnestGCPrivateKeyRec;
@@ -41,5 +43,6 @@ void xnestDestroyGC(GCPtr pGC);
 void xnestChangeClip(GCPtr pGC, int type, void *pValue, int nRects);
 void xnestDestroyClip(GCPtr pGC);
 void xnestCopyClip(GCPtr pGCDst, GCPtr pGCSrc);
+void xnestSetGCExposures(GCPtr pGC, Bool exposures);
 
 #endif                          /* XNESTGC_H */
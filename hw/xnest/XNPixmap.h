@@ -23,6 +23,8 @@ extern DevPrivateKeyRec xnestPixmapPrivateKeyRec;
 
 typedef struct {
     Pixmap pixmap;
+    char *shadow;               /* local copy of the contents, -pixmapshadow */
+    RegionRec shadowValid;      /* the part of shadow known to be current */
 } xnestPrivPixmap;
 
 #define xnestPixmapPriv(pPixmap) ((xnestPrivPixmap *) \
@@ -38,5 +40,10 @@ Bool xnestDestroyPixmap(PixmapPtr pPixmap);
 Bool xnestModifyPixmapHeader(PixmapPtr pPixmap, int width, int height, int depth,
                              int bitsPerPixel, int devKind, void *pPixData);
 RegionPtr xnestPixmapToRegion(PixmapPtr pPixmap);
+void xnestPixmapShadowDamage(DrawablePtr pDrawable, const BoxRec *pBox);
+void xnestPixmapShadowPut(DrawablePtr pDrawable, int x, int y, int w, int h,
+                          const char *pImage);
+Bool xnestPixmapShadowGet(DrawablePtr pDrawable, int x, int y, int w, int h,
+                          char *pImage);
 
 #endif                          /* XNESTPIXMAP_H */
@@ -73,7 +73,7 @@ void xnest_wm_colormap_windows(
     if (!reply)
         return;
 
-    xcb_icccm_set_wm_colormap_windows_checked(
+    xcb_icccm_set_wm_colormap_windows(
         conn,
         w,
         reply->atom,
@@ -120,6 +120,30 @@ extern _X_EXPORT void
 extern _X_EXPORT void
  DamageSetReportAfterOp(DamagePtr pDamage, Bool reportAfter);
 
+/*
+ * Bound the accumulated damage region to at most maxRects rectangles.
+ * Once exceeded, the region is merged into tileSize aligned boxes, or
+ * into its bounding box if that is still too fragmented.  The region
+ * always covers the true damage.  maxRects <= 0 disables coarsening.
+ */
+extern _X_EXPORT void
+ DamageSetCoarsening(DamagePtr pDamage, int maxRects, int tileSize);
+
+/*
+ * Accumulate damage in a bitmap of tileSize x tileSize tiles (rounded
+ * up to a power of two) instead of a region.  Appending damage then
+ * costs O(rects) regardless of how fragmented the total gets, and
+ * DamageRegion() converts the bitmap into a tile granular region only
+ * when asked.  Only available for DamageReportNone or report-less
+ * damages.  tileSize <= 0 goes back to plain region tracking.
+ */
+extern _X_EXPORT Bool
+ DamageSetTileTracking(DamagePtr pDamage, int tileSize);
+
+/* Cheaper than RegionNotEmpty(DamageRegion()) under tile tracking. */
+extern _X_EXPORT Bool
+ DamageNotEmpty(DamagePtr pDamage);
+
 extern _X_EXPORT DamageScreenFuncsPtr DamageGetScreenFuncs(ScreenPtr);
 
 #endif                          /* _DAMAGE_H_ */
@@ -22,6 +22,8 @@
 #ifndef _DAMAGESTR_H_
 #define _DAMAGESTR_H_
 
+#include <stdint.h>
+
 #include "damage.h"
 #include "gcstruct.h"
 #include "privates.h"
@@ -44,6 +46,16 @@ typedef struct _damage {
     Bool reportAfter;
     RegionRec pendingDamage;    /* will be flushed post submission at the latest */
     ScreenPtr pScreen;
+
+    int maxRects;               /* coarsen damage beyond this many rects, 0 = never */
+    int tileSize;               /* tile grid used when coarsening */
+
+    /* Dirty tile bitmap, see DamageSetTileTracking */
+    uint64_t *tileBits;
+    int tileShift;              /* log2 of the tile size, 0 = region only */
+    int tileCols, tileRows, tileStride;
+    BoxRec tileBounds;          /* drawable relative area the bitmap covers */
+    Bool tileRegionValid;       /* damage region matches the bitmap */
 } DamageRec;
 
 typedef struct _damageScrPriv {
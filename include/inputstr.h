@@ -237,6 +237,13 @@ typedef struct _SpriteRec {
     ScreenPtr pEnqueueScreen;
     ScreenPtr pDequeueScreen;
 
+    /* Cached XYToWindow result: the spriteTrace stays valid for any
+     * point inside pickSafe as long as windowsRestructuredSerial equals
+     * pickSerial and nobody else touched the trace. */
+    unsigned long pickSerial;
+    ScreenPtr pickScreen;
+    int pickTraceGood;
+    BoxRec pickSafe;
 } SpriteRec;
 
 typedef struct _KeyClassRec {
@@ -48,6 +48,8 @@ typedef struct _SyncCounter {
     SyncObject sync;            /* Common sync object data */
     int64_t value;              /* counter value */
     struct _SysCounterInfo *pSysCounterInfo; /* NULL if not a system counter */
+    int64_t trigger_less;       /* no trigger can fire while the value */
+    int64_t trigger_greater;    /* stays strictly between these two */
 } SyncCounter;
 
 struct _SyncFence {
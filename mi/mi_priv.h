@@ -86,6 +86,8 @@ void miMarkUnrealizedWindow(WindowPtr pChild, WindowPtr pWin, Bool fromConfigure
 WindowPtr miSpriteTrace(SpritePtr pSprite, int x, int y);
 WindowPtr miXYToWindow(ScreenPtr pScreen, SpritePtr pSprite, int x, int y);
 
+extern DevPrivateKeyRec miPickGridKeyRec;
+
 _X_EXPORT /* used by in-tree libwfb.so module */
 int miExpandDirectColors(ColormapPtr, int, xColorItem *, xColorItem *);
 
@@ -95,6 +97,8 @@ typedef union _MiValidate {
         RegionPtr borderVisible;        /* visible region of border, */
         /* non-null when size changes */
         Bool resized;           /* unclipped winSize has changed */
+        Bool overlapOnly;       /* marked only for overlapping a changed */
+        /* sibling, own geometry untouched */
     } before;
     struct AfterValidate {
         RegionRec exposed;      /* exposed regions, absolute pos */
@@ -291,6 +291,8 @@ miScreenInit(ScreenPtr pScreen, void *pbits,  /* pointer to screen bits */
     pScreen->SetShape = miSetShape;
     pScreen->MarkUnrealizedWindow = miMarkUnrealizedWindow;
     pScreen->XYToWindow = miXYToWindow;
+    if (!dixRegisterPrivateKey(&miPickGridKeyRec, PRIVATE_SCREEN, 0))
+        return FALSE;
 
     miSetZeroLineBias(pScreen, DEFAULTZEROLINEBIAS);
 
@@ -171,6 +171,37 @@ miShapedWindowIn(RegionPtr universe, RegionPtr bounding,
 				    HasBorder(w) && \
 				    (w)->backgroundState == ParentRelative)
 
+/*
+ * Reset the exposure bookkeeping of pParent and its marked inferiors
+ * without touching their clips.  Used when a window was only marked
+ * because it is overlapped by a changed sibling and its new clip turns
+ * out to be identical to the old one: nothing in the subtree can have
+ * changed then.
+ */
+static void
+miSkipUnchangedClips(WindowPtr pParent)
+{
+    WindowPtr pChild = pParent;
+
+    while (1) {
+        if (pChild->viewable) {
+            if (pChild->valdata) {
+                RegionNull(&pChild->valdata->after.borderExposed);
+                RegionNull(&pChild->valdata->after.exposed);
+            }
+            if (pChild->firstChild) {
+                pChild = pChild->firstChild;
+                continue;
+            }
+        }
+        while (!pChild->nextSib && (pChild != pParent))
+            pChild = pChild->parent;
+        if (pChild == pParent)
+            break;
+        pChild = pChild->nextSib;
+    }
+}
+
 /*
  *-----------------------------------------------------------------------
  * miComputeClips --
@@ -270,6 +301,20 @@ miComputeClips(WindowPtr pParent,
     dx = pParent->drawable.x - pParent->valdata->before.oldAbsCorner.x;
     dy = pParent->drawable.y - pParent->valdata->before.oldAbsCorner.y;
 
+    /*
+     * A window that didn't change itself and ends up with the same
+     * borderClip keeps all clips in its subtree; with many overlapped
+     * windows or deep trees this avoids recomputing most of them.
+     */
+    if (pParent->valdata->before.overlapOnly &&
+        !pParent->valdata->before.borderVisible &&
+        !dx && !dy && kind != VTBroken &&
+        oldVis != VisibilityNotViewable &&
+        RegionEqual(universe, &pParent->borderClip)) {
+        miSkipUnchangedClips(pParent);
+        return;
+    }
+
     /*
      * avoid computations when dealing with simple operations
      */
@@ -46,13 +46,16 @@ SOFTWARE.
 ******************************************************************/
 #include <dix-config.h>
 
+#include <stdint.h>
 #include <X11/X.h>
 #include <X11/extensions/shapeconst.h>
 
 #include "dix/cursor_priv.h"
 #include "dix/dix_priv.h"
 #include "dix/input_priv.h"
+#include "dix/screen_hooks_priv.h"
 #include "dix/window_priv.h"
+#include "include/extinit.h"
 #include "include/regionstr.h"
 #include "mi/mi_priv.h"
 
@@ -185,7 +188,16 @@ miMarkOverlappedWindows(WindowPtr pWin, WindowPtr pFirst, WindowPtr *ppLayerWin)
                 if (RegionBroken(&pChild->borderSize))
                     SetBorderSize(pChild);
                 if (RegionContainsRect(&pChild->borderSize, box)) {
+                    Bool wasMarked = (pChild->valdata != NULL);
+
                     (*MarkWindow) (pChild);
+                    /*
+                     * Nothing about this window or its inferiors changes,
+                     * it just may get a different clip; remember that so
+                     * miComputeClips can skip the subtree if it doesn't.
+                     */
+                    if (!wasMarked && pChild->valdata)
+                        pChild->valdata->before.overlapOnly = TRUE;
                     anyMarked = TRUE;
                     if (pChild->firstChild) {
                         pChild = pChild->firstChild;
@@ -743,42 +755,177 @@ miMarkUnrealizedWindow(WindowPtr pChild, WindowPtr pWin, Bool fromConfigure)
     }
 }
 
-WindowPtr
-miSpriteTrace(SpritePtr pSprite, int x, int y)
+/*
+ * Pointer picking.
+ *
+ * Besides the plain tree walk, miXYToWindow keeps two caches, both
+ * validated against windowsRestructuredSerial:
+ *
+ *  - per sprite, a rectangle around the last picked point inside which
+ *    every window looked at during the walk gives the same answer, so
+ *    the previous spriteTrace can be reused as is;
+ *  - per screen, a coarse grid listing the top level windows overlapping
+ *    each cell in stacking order, so screens with many override-redirect
+ *    windows don't have to test all of them on every motion event.
+ */
+
+#define MI_PICK_GRID            16      /* cells per screen dimension */
+#define MI_PICK_MIN_TOPLEVELS   16      /* below this walking is as cheap */
+
+typedef struct {
+    int x1, y1, x2, y2;
+} miPickBoxRec, *miPickBoxPtr;
+
+typedef struct {
+    unsigned long serial;       /* windowsRestructuredSerial of the grid */
+    int picks;                  /* picks at this serial so far */
+    Bool valid;
+    int width, height;          /* root size the grid was built for */
+    int cellStart[MI_PICK_GRID * MI_PICK_GRID + 1];
+    WindowPtr *windows;
+    int size;
+} miPickGridRec, *miPickGridPtr;
+
+DevPrivateKeyRec miPickGridKeyRec;
+
+#define miPickGridKey (&miPickGridKeyRec)
+
+static void
+miPickPoint(miPickBoxPtr pSafe, int x, int y)
 {
-    WindowPtr pWin;
+    pSafe->x1 = x;
+    pSafe->y1 = y;
+    pSafe->x2 = x + 1;
+    pSafe->y2 = y + 1;
+}
+
+static void
+miPickIntersect(miPickBoxPtr pSafe, int x1, int y1, int x2, int y2)
+{
+    pSafe->x1 = max(pSafe->x1, x1);
+    pSafe->y1 = max(pSafe->y1, y1);
+    pSafe->x2 = min(pSafe->x2, x2);
+    pSafe->y2 = min(pSafe->y2, y2);
+}
+
+/* Shrink *pSafe around x/y so it no longer overlaps the given box */
+static void
+miPickExclude(miPickBoxPtr pSafe, int x, int y, int x1, int y1, int x2, int y2)
+{
+    miPickBoxRec cut[4];
+    int n = 0;
+    int64_t best = -1;
+
+    if (x1 >= pSafe->x2 || x2 <= pSafe->x1 ||
+        y1 >= pSafe->y2 || y2 <= pSafe->y1)
+        return;
+
+    if (x2 <= x) {
+        cut[n] = *pSafe;
+        cut[n++].x1 = x2;
+    }
+    if (x1 > x) {
+        cut[n] = *pSafe;
+        cut[n++].x2 = x1;
+    }
+    if (y2 <= y) {
+        cut[n] = *pSafe;
+        cut[n++].y1 = y2;
+    }
+    if (y1 > y) {
+        cut[n] = *pSafe;
+        cut[n++].y2 = y1;
+    }
+    if (!n) {
+        miPickPoint(pSafe, x, y);
+        return;
+    }
+    while (n--) {
+        int64_t area = (int64_t) (cut[n].x2 - cut[n].x1) *
+            (cut[n].y2 - cut[n].y1);
+
+        if (area > best) {
+            best = area;
+            *pSafe = cut[n];
+        }
+    }
+}
+
+/*
+ * Is x/y within the input area of pWin?  Narrows *pSafe to an area
+ * around x/y for which the answer stays the same.
+ */
+static Bool
+miPickWindow(WindowPtr pWin, int x, int y, miPickBoxPtr pSafe)
+{
+    int bw = wBorderWidth(pWin);
+    int x1 = pWin->drawable.x - bw;
+    int y1 = pWin->drawable.y - bw;
+    int x2 = pWin->drawable.x + (int) pWin->drawable.width + bw;
+    int y2 = pWin->drawable.y + (int) pWin->drawable.height + bw;
     BoxRec box;
 
-    pWin = DeepestSpriteWin(pSprite)->firstChild;
+    /* In rootless mode windows may be offscreen, even when
+     * they're in X's stack. (E.g. if the native window system
+     * implements some form of virtual desktop system).
+     */
+    if (!pWin->mapped || pWin->unhittable)
+        return FALSE;
+
+    if (x < x1 || x >= x2 || y < y1 || y >= y2) {
+        miPickExclude(pSafe, x, y, x1, y1, x2, y2);
+        return FALSE;
+    }
+    miPickIntersect(pSafe, x1, y1, x2, y2);
+
+    /* When a window is shaped, a further check
+     * is made to see if the point is inside
+     * borderSize
+     */
+    if (wBoundingShape(pWin)) {
+        if (RegionContainsPoint(&pWin->borderSize, x, y, &box))
+            miPickIntersect(pSafe, box.x1, box.y1, box.x2, box.y2);
+        else {
+            miPickPoint(pSafe, x, y);
+            if (!PointInBorderSize(pWin, x, y))
+                return FALSE;
+        }
+    }
+
+    if (wInputShape(pWin)) {
+        if (!RegionContainsPoint(wInputShape(pWin),
+                                 x - pWin->drawable.x,
+                                 y - pWin->drawable.y, &box)) {
+            miPickPoint(pSafe, x, y);
+            return FALSE;
+        }
+        miPickIntersect(pSafe,
+                        box.x1 + pWin->drawable.x, box.y1 + pWin->drawable.y,
+                        box.x2 + pWin->drawable.x, box.y2 + pWin->drawable.y);
+    }
+
+    return TRUE;
+}
+
+static void
+miSpriteTracePush(SpritePtr pSprite, WindowPtr pWin)
+{
+    if (pSprite->spriteTraceGood >= pSprite->spriteTraceSize) {
+        pSprite->spriteTraceSize += 10;
+        pSprite->spriteTrace = reallocarray(pSprite->spriteTrace,
+                                            pSprite->spriteTraceSize,
+                                            sizeof(WindowPtr));
+    }
+    pSprite->spriteTrace[pSprite->spriteTraceGood++] = pWin;
+}
+
+static WindowPtr
+miSpriteTraceFrom(SpritePtr pSprite, WindowPtr pWin, int x, int y,
+                  miPickBoxPtr pSafe)
+{
     while (pWin) {
-        if ((pWin->mapped) &&
-            (x >= pWin->drawable.x - wBorderWidth(pWin)) &&
-            (x < pWin->drawable.x + (int) pWin->drawable.width +
-             wBorderWidth(pWin)) &&
-            (y >= pWin->drawable.y - wBorderWidth(pWin)) &&
-            (y < pWin->drawable.y + (int) pWin->drawable.height +
-             wBorderWidth(pWin))
-            /* When a window is shaped, a further check
-             * is made to see if the point is inside
-             * borderSize
-             */
-            && (!wBoundingShape(pWin) || PointInBorderSize(pWin, x, y))
-            && (!wInputShape(pWin) ||
-                RegionContainsPoint(wInputShape(pWin),
-                                    x - pWin->drawable.x,
-                                    y - pWin->drawable.y, &box))
-            /* In rootless mode windows may be offscreen, even when
-             * they're in X's stack. (E.g. if the native window system
-             * implements some form of virtual desktop system).
-             */
-            && !pWin->unhittable) {
-            if (pSprite->spriteTraceGood >= pSprite->spriteTraceSize) {
-                pSprite->spriteTraceSize += 10;
-                pSprite->spriteTrace = reallocarray(pSprite->spriteTrace,
-                                                    pSprite->spriteTraceSize,
-                                                    sizeof(WindowPtr));
-            }
-            pSprite->spriteTrace[pSprite->spriteTraceGood++] = pWin;
+        if (miPickWindow(pWin, x, y, pSafe)) {
+            miSpriteTracePush(pSprite, pWin);
             pWin = pWin->firstChild;
         }
         else
@@ -787,6 +934,128 @@ miSpriteTrace(SpritePtr pSprite, int x, int y)
     return DeepestSpriteWin(pSprite);
 }
 
+WindowPtr
+miSpriteTrace(SpritePtr pSprite, int x, int y)
+{
+    miPickBoxRec safe = { MINSHORT, MINSHORT, MAXSHORT, MAXSHORT };
+
+    return miSpriteTraceFrom(pSprite, DeepestSpriteWin(pSprite)->firstChild,
+                             x, y, &safe);
+}
+
+static void
+miPickGridClose(CallbackListPtr *pcbl, ScreenPtr pScreen, void *unused)
+{
+    miPickGridPtr pGrid = dixLookupPrivate(&pScreen->devPrivates,
+                                           miPickGridKey);
+
+    dixScreenUnhookClose(pScreen, miPickGridClose);
+    if (pGrid) {
+        free(pGrid->windows);
+        free(pGrid);
+        dixSetPrivate(&pScreen->devPrivates, miPickGridKey, NULL);
+    }
+}
+
+static void
+miPickGridCells(miPickGridPtr pGrid, WindowPtr pWin, int *cx1, int *cy1,
+                int *cx2, int *cy2)
+{
+    int bw = wBorderWidth(pWin);
+
+    *cx1 = max(pWin->drawable.x - bw, 0) * MI_PICK_GRID / pGrid->width;
+    *cy1 = max(pWin->drawable.y - bw, 0) * MI_PICK_GRID / pGrid->height;
+    *cx2 = (min(pWin->drawable.x + (int) pWin->drawable.width + bw,
+                pGrid->width) - 1) * MI_PICK_GRID / pGrid->width;
+    *cy2 = (min(pWin->drawable.y + (int) pWin->drawable.height + bw,
+                pGrid->height) - 1) * MI_PICK_GRID / pGrid->height;
+}
+
+static Bool
+miPickGridBuild(miPickGridPtr pGrid, WindowPtr pRoot)
+{
+    int count[MI_PICK_GRID * MI_PICK_GRID] = { 0 };
+    int fill[MI_PICK_GRID * MI_PICK_GRID];
+    int cx1, cy1, cx2, cy2, total = 0, toplevels = 0;
+    WindowPtr pWin;
+
+    pGrid->width = pRoot->drawable.width;
+    pGrid->height = pRoot->drawable.height;
+    if (pGrid->width <= 0 || pGrid->height <= 0)
+        return FALSE;
+
+    for (pWin = pRoot->firstChild; pWin; pWin = pWin->nextSib) {
+        if (!pWin->mapped || pWin->unhittable)
+            continue;
+        toplevels++;
+        miPickGridCells(pGrid, pWin, &cx1, &cy1, &cx2, &cy2);
+        for (int cy = cy1; cy <= cy2; cy++)
+            for (int cx = cx1; cx <= cx2; cx++)
+                count[cy * MI_PICK_GRID + cx]++;
+    }
+    if (toplevels < MI_PICK_MIN_TOPLEVELS)
+        return FALSE;
+
+    for (int i = 0; i < MI_PICK_GRID * MI_PICK_GRID; i++) {
+        pGrid->cellStart[i] = fill[i] = total;
+        total += count[i];
+    }
+    pGrid->cellStart[MI_PICK_GRID * MI_PICK_GRID] = total;
+
+    if (total > pGrid->size) {
+        WindowPtr *windows = reallocarray(pGrid->windows, total,
+                                          sizeof(WindowPtr));
+        if (!windows)
+            return FALSE;
+        pGrid->windows = windows;
+        pGrid->size = total;
+    }
+
+    /* Walk top to bottom so each cell lists windows in stacking order */
+    for (pWin = pRoot->firstChild; pWin; pWin = pWin->nextSib) {
+        if (!pWin->mapped || pWin->unhittable)
+            continue;
+        miPickGridCells(pGrid, pWin, &cx1, &cy1, &cx2, &cy2);
+        for (int cy = cy1; cy <= cy2; cy++)
+            for (int cx = cx1; cx <= cx2; cx++)
+                pGrid->windows[fill[cy * MI_PICK_GRID + cx]++] = pWin;
+    }
+    return TRUE;
+}
+
+static miPickGridPtr
+miPickGridGet(ScreenPtr pScreen)
+{
+    miPickGridPtr pGrid;
+
+    if (!dixPrivateKeyRegistered(miPickGridKey))
+        return NULL;
+
+    pGrid = dixLookupPrivate(&pScreen->devPrivates, miPickGridKey);
+    if (!pGrid) {
+        pGrid = calloc(1, sizeof(miPickGridRec));
+        if (!pGrid)
+            return NULL;
+        dixSetPrivate(&pScreen->devPrivates, miPickGridKey, pGrid);
+        dixScreenHookClose(pScreen, miPickGridClose);
+    }
+
+    if (pGrid->serial != windowsRestructuredSerial) {
+        pGrid->serial = windowsRestructuredSerial;
+        pGrid->picks = 0;
+        pGrid->valid = FALSE;
+    }
+
+    /*
+     * Right after a restructure there usually is a single pick from
+     * WindowsRestructured(); only build the grid once it pays off.
+     */
+    if (!pGrid->valid && ++pGrid->picks == 2)
+        pGrid->valid = miPickGridBuild(pGrid, pScreen->root);
+
+    return pGrid->valid ? pGrid : NULL;
+}
+
 /**
  * Traversed from the root window to the window at the position x/y. While
  * traversing, it sets up the traversal history in the spriteTrace array.
@@ -801,6 +1070,69 @@ miSpriteTrace(SpritePtr pSprite, int x, int y)
 WindowPtr
 miXYToWindow(ScreenPtr pScreen, SpritePtr pSprite, int x, int y)
 {
+    miPickBoxRec safe = { MINSHORT, MINSHORT, MAXSHORT, MAXSHORT };
+    miPickGridPtr pGrid;
+    WindowPtr pRoot = pScreen->root;
+    WindowPtr pWin = NULL;
+
+#ifdef XINERAMA
+    /* PointInBorderSize looks at the other screens' windows too */
+    if (!noPanoramiXExtension) {
+        pSprite->spriteTraceGood = 1;       /* root window still there */
+        return miSpriteTrace(pSprite, x, y);
+    }
+#endif /* XINERAMA */
+
+    if (pSprite->pickSerial == windowsRestructuredSerial &&
+        pSprite->pickScreen == pScreen &&
+        pSprite->pickTraceGood == pSprite->spriteTraceGood &&
+        pSprite->spriteTrace[0] == pRoot &&
+        x >= pSprite->pickSafe.x1 && x < pSprite->pickSafe.x2 &&
+        y >= pSprite->pickSafe.y1 && y < pSprite->pickSafe.y2)
+        return DeepestSpriteWin(pSprite);
+
     pSprite->spriteTraceGood = 1;       /* root window still there */
-    return miSpriteTrace(pSprite, x, y);
+
+    if (pSprite->spriteTrace[0] == pRoot &&
+        (pGrid = miPickGridGet(pScreen)) &&
+        x >= 0 && x < pGrid->width && y >= 0 && y < pGrid->height) {
+        int cx = x * MI_PICK_GRID / pGrid->width;
+        int cy = y * MI_PICK_GRID / pGrid->height;
+        int cell = cy * MI_PICK_GRID + cx;
+
+        /* Windows not listed for this cell can't be hit anywhere in it */
+        miPickIntersect(&safe,
+                        (cx * pGrid->width + MI_PICK_GRID - 1) / MI_PICK_GRID,
+                        (cy * pGrid->height + MI_PICK_GRID - 1) / MI_PICK_GRID,
+                        ((cx + 1) * pGrid->width + MI_PICK_GRID - 1) /
+                        MI_PICK_GRID,
+                        ((cy + 1) * pGrid->height + MI_PICK_GRID - 1) /
+                        MI_PICK_GRID);
+
+        for (int i = pGrid->cellStart[cell]; i < pGrid->cellStart[cell + 1];
+             i++) {
+            if (miPickWindow(pGrid->windows[i], x, y, &safe)) {
+                miSpriteTracePush(pSprite, pGrid->windows[i]);
+                pWin = miSpriteTraceFrom(pSprite,
+                                         pGrid->windows[i]->firstChild,
+                                         x, y, &safe);
+                break;
+            }
+        }
+        if (!pWin)
+            pWin = DeepestSpriteWin(pSprite);
+    }
+    else
+        pWin = miSpriteTraceFrom(pSprite, DeepestSpriteWin(pSprite)->firstChild,
+                                 x, y, &safe);
+
+    pSprite->pickSerial = windowsRestructuredSerial;
+    pSprite->pickScreen = pScreen;
+    pSprite->pickTraceGood = pSprite->spriteTraceGood;
+    pSprite->pickSafe.x1 = max(safe.x1, MINSHORT);
+    pSprite->pickSafe.y1 = max(safe.y1, MINSHORT);
+    pSprite->pickSafe.x2 = min(safe.x2, MAXSHORT);
+    pSprite->pickSafe.y2 = min(safe.y2, MAXSHORT);
+
+    return pWin;
 }
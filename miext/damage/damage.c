@@ -22,7 +22,9 @@
 
 #include <dix-config.h>
 
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "dix/screen_hooks_priv.h"
 #include "os/osdep.h"
@@ -43,6 +45,8 @@
 #include    "damagestr.h"
 #include    "glyphstr_priv.h"
 
+#include    "damage_priv.h"
+
 #define wrap(priv, real, mem, func) {\
     priv->mem = real->mem; \
     real->mem = func; \
@@ -123,6 +127,298 @@ getDrawableDamageRef(DrawablePtr pDrawable)
     DamagePtr	*pPrev = (DamagePtr *) \
 	dixLookupPrivateAddr(&(pWindow)->devPrivates, damageWinPrivateKey)
 
+/*
+ * Replace a region holding more than maxRects rectangles with a covering
+ * built from tileSize aligned boxes, clipped to the original extents so
+ * the bounding box never grows.  When the tiled covering is still too
+ * fragmented, fall back to the extents.  Returns TRUE if pRegion changed.
+ */
+Bool
+damageCoarsenRegion(RegionPtr pRegion, int maxRects, int tileSize)
+{
+    BoxRec extents;
+    BoxPtr pSrc, pDst, boxes;
+    int nSrc, nDst;
+
+    if (maxRects <= 0 || RegionNumRects(pRegion) <= maxRects)
+        return FALSE;
+
+    extents = *RegionExtents(pRegion);
+
+    if (tileSize > 1) {
+        nSrc = RegionNumRects(pRegion);
+        pSrc = RegionRects(pRegion);
+        boxes = calloc(nSrc, sizeof(BoxRec));
+        if (boxes) {
+            RegionRec tiles;
+
+            pDst = boxes;
+            nDst = 0;
+            while (nSrc--) {
+                BoxRec box;
+
+                box.x1 = max(pSrc->x1 - ((pSrc->x1 - extents.x1) % tileSize),
+                             extents.x1);
+                box.y1 = max(pSrc->y1 - ((pSrc->y1 - extents.y1) % tileSize),
+                             extents.y1);
+                box.x2 = min(pSrc->x2 + (tileSize - 1) -
+                             ((pSrc->x2 - extents.x1 + tileSize - 1) % tileSize),
+                             extents.x2);
+                box.y2 = min(pSrc->y2 + (tileSize - 1) -
+                             ((pSrc->y2 - extents.y1 + tileSize - 1) % tileSize),
+                             extents.y2);
+                pSrc++;
+
+                /* Banded input yields runs of identical tile boxes */
+                if (nDst && BOX_SAME(&box, pDst - 1))
+                    continue;
+                *pDst++ = box;
+                nDst++;
+            }
+
+            if (pixman_region_init_rects(&tiles, boxes, nDst)) {
+                if (RegionNumRects(&tiles) <= maxRects) {
+                    RegionCopy(pRegion, &tiles);
+                    RegionUninit(&tiles);
+                    free(boxes);
+                    return TRUE;
+                }
+                RegionUninit(&tiles);
+            }
+            free(boxes);
+        }
+    }
+
+    RegionReset(pRegion, &extents);
+    return TRUE;
+}
+
+/*
+ * Apply the coarsening policy set with DamageSetCoarsening to the
+ * accumulated damage.
+ */
+static void
+damageCoarsen(DamagePtr pDamage)
+{
+    RegionRec before;
+
+    if (pDamage->maxRects <= 0 ||
+        RegionNumRects(&pDamage->damage) <= pDamage->maxRects)
+        return;
+
+    if (pDamage->damageLevel != DamageReportDeltaRegion ||
+        !pDamage->damageReport) {
+        damageCoarsenRegion(&pDamage->damage, pDamage->maxRects,
+                            pDamage->tileSize);
+        return;
+    }
+
+    /*
+     * Delta listeners are only told about damage outside of the
+     * accumulated region, so anything coarsening adds to it must be
+     * reported too or later drawing there would go unnoticed.
+     */
+    RegionNull(&before);
+    RegionCopy(&before, &pDamage->damage);
+    if (damageCoarsenRegion(&pDamage->damage, pDamage->maxRects,
+                            pDamage->tileSize)) {
+        RegionSubtract(&before, &pDamage->damage, &before);
+        if (RegionNotEmpty(&before))
+            (*pDamage->damageReport) (pDamage, &before, pDamage->closure);
+    }
+    RegionUninit(&before);
+}
+
+/*
+ * Dirty tile tracking (DamageSetTileTracking).  The bitmap is the
+ * authoritative copy of the accumulated damage; pDamage->damage is only
+ * rebuilt from it when someone asks for the region.
+ */
+
+static Bool
+damageTilesBounds(DamagePtr pDamage, BoxPtr pBounds)
+{
+    DrawablePtr pDrawable = pDamage->pDrawable;
+    int bw = 0;
+
+    if (!pDrawable)
+        return FALSE;
+    if (pDrawable->type == DRAWABLE_WINDOW)
+        bw = wBorderWidth((WindowPtr) pDrawable);
+    pBounds->x1 = -bw;
+    pBounds->y1 = -bw;
+    pBounds->x2 = pDrawable->width + bw;
+    pBounds->y2 = pDrawable->height + bw;
+    return TRUE;
+}
+
+static void
+damageTilesMarkBoxes(DamagePtr pDamage, BoxPtr pBox, int nBox)
+{
+    BoxPtr pBounds = &pDamage->tileBounds;
+    int shift = pDamage->tileShift;
+
+    for (; nBox--; pBox++) {
+        int x1 = max(pBox->x1, pBounds->x1) - pBounds->x1;
+        int y1 = max(pBox->y1, pBounds->y1) - pBounds->y1;
+        int x2 = min(pBox->x2, pBounds->x2) - pBounds->x1;
+        int y2 = min(pBox->y2, pBounds->y2) - pBounds->y1;
+        int c1, c2, w1, w2;
+        uint64_t m1, m2;
+
+        if (x1 >= x2 || y1 >= y2)
+            continue;
+
+        c1 = x1 >> shift;
+        c2 = (x2 - 1) >> shift;
+        w1 = c1 >> 6;
+        w2 = c2 >> 6;
+        m1 = ~(uint64_t) 0 << (c1 & 63);
+        m2 = ~(uint64_t) 0 >> (63 - (c2 & 63));
+
+        for (int r = y1 >> shift; r <= (y2 - 1) >> shift; r++) {
+            uint64_t *row = pDamage->tileBits + r * pDamage->tileStride;
+
+            if (w1 == w2)
+                row[w1] |= m1 & m2;
+            else {
+                row[w1] |= m1;
+                for (int w = w1 + 1; w < w2; w++)
+                    row[w] = ~(uint64_t) 0;
+                row[w2] |= m2;
+            }
+        }
+        pDamage->tileRegionValid = FALSE;
+    }
+}
+
+/* Bring pDamage->damage up to date with the tile bitmap. */
+static void
+damageTilesValidateRegion(DamagePtr pDamage)
+{
+    BoxPtr pBounds = &pDamage->tileBounds;
+    int shift = pDamage->tileShift;
+    BoxPtr boxes;
+    int n = 0;
+    RegionRec tiles;
+
+    if (pDamage->tileRegionValid)
+        return;
+    pDamage->tileRegionValid = TRUE;
+
+    /* At most one run every other tile */
+    boxes = calloc(pDamage->tileRows * ((pDamage->tileCols + 1) / 2),
+                   sizeof(BoxRec));
+    if (!boxes) {
+        RegionReset(&pDamage->damage, pBounds);
+        return;
+    }
+
+    for (int r = 0; r < pDamage->tileRows; r++) {
+        uint64_t *row = pDamage->tileBits + r * pDamage->tileStride;
+        int c = 0;
+
+        while (c < pDamage->tileCols) {
+            int start;
+
+            if (!row[c >> 6]) {
+                c = (c | 63) + 1;
+                continue;
+            }
+            if (!(row[c >> 6] & ((uint64_t) 1 << (c & 63)))) {
+                c++;
+                continue;
+            }
+            start = c;
+            while (c < pDamage->tileCols &&
+                   (row[c >> 6] & ((uint64_t) 1 << (c & 63))))
+                c++;
+
+            boxes[n].x1 = pBounds->x1 + (start << shift);
+            boxes[n].y1 = pBounds->y1 + (r << shift);
+            boxes[n].x2 = min(pBounds->x1 + (c << shift), pBounds->x2);
+            boxes[n].y2 = min(pBounds->y1 + ((r + 1) << shift), pBounds->y2);
+            n++;
+        }
+    }
+
+    if (pixman_region_init_rects(&tiles, boxes, n)) {
+        RegionCopy(&pDamage->damage, &tiles);
+        RegionUninit(&tiles);
+    }
+    else
+        RegionReset(&pDamage->damage, pBounds);
+    free(boxes);
+}
+
+/* Drop the bitmap and go back to accumulating into the region. */
+static void
+damageTilesFini(DamagePtr pDamage)
+{
+    damageTilesValidateRegion(pDamage);
+    free(pDamage->tileBits);
+    pDamage->tileBits = NULL;
+    pDamage->tileShift = 0;
+    pDamage->tileCols = pDamage->tileRows = pDamage->tileStride = 0;
+}
+
+/* (Re)size the bitmap to cover pBounds, carrying over existing damage. */
+static Bool
+damageTilesResize(DamagePtr pDamage, BoxPtr pBounds)
+{
+    int shift = pDamage->tileShift;
+    int cols = ((pBounds->x2 - pBounds->x1) + (1 << shift) - 1) >> shift;
+    int rows = ((pBounds->y2 - pBounds->y1) + (1 << shift) - 1) >> shift;
+    int stride = (cols + 63) >> 6;
+    uint64_t *bits;
+
+    bits = calloc(max(stride * rows, 1), sizeof(uint64_t));
+    if (!bits)
+        return FALSE;
+
+    damageTilesValidateRegion(pDamage);
+    free(pDamage->tileBits);
+    pDamage->tileBits = bits;
+    pDamage->tileBounds = *pBounds;
+    pDamage->tileCols = cols;
+    pDamage->tileRows = rows;
+    pDamage->tileStride = stride;
+
+    damageTilesMarkBoxes(pDamage, RegionRects(&pDamage->damage),
+                         RegionNumRects(&pDamage->damage));
+    pDamage->tileRegionValid = TRUE;
+    return TRUE;
+}
+
+static Bool
+damageTilesMark(DamagePtr pDamage, RegionPtr pRegion)
+{
+    BoxRec bounds;
+
+    if (!damageTilesBounds(pDamage, &bounds))
+        return FALSE;
+
+    if (!pDamage->tileBits || !BOX_SAME(&bounds, &pDamage->tileBounds)) {
+        if (!damageTilesResize(pDamage, &bounds)) {
+            damageTilesFini(pDamage);
+            return FALSE;
+        }
+    }
+
+    damageTilesMarkBoxes(pDamage, RegionRects(pRegion),
+                         RegionNumRects(pRegion));
+    return TRUE;
+}
+
+static void
+damageAccumulate(DamagePtr pDamage, RegionPtr pRegion)
+{
+    if (pDamage->tileShift && damageTilesMark(pDamage, pRegion))
+        return;
+    RegionUnion(&pDamage->damage, &pDamage->damage, pRegion);
+    damageCoarsen(pDamage);
+}
+
 #if DAMAGE_DEBUG_ENABLE
 static void
 _damageRegionAppend(DrawablePtr pDrawable, RegionPtr pRegion, Bool clip,
@@ -261,7 +557,7 @@ damageRegionAppend(DrawablePtr pDrawable, RegionPtr pRegion, Bool clip,
             if (pDamage->damageReport)
                 DamageReportDamage(pDamage, pDamageRegion);
             else
-                RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
+                damageAccumulate(pDamage, pDamageRegion);
         }
 
         /*
@@ -287,8 +583,7 @@ damageRegionProcessPending(DrawablePtr pDrawable)
             if (pDamage->damageReport)
                 DamageReportDamage(pDamage, &pDamage->pendingDamage);
             else
-                RegionUnion(&pDamage->damage, &pDamage->damage,
-                            &pDamage->pendingDamage);
+                damageAccumulate(pDamage, &pDamage->pendingDamage);
         }
 
         if (pDamage->reportAfter)
@@ -1709,6 +2004,11 @@ DamageCreate(DamageReportFunc damageReport,
     pDamage->isWindow = FALSE;
     pDamage->pDrawable = 0;
     pDamage->reportAfter = FALSE;
+    pDamage->maxRects = 0;
+    pDamage->tileSize = 0;
+    pDamage->tileBits = NULL;
+    pDamage->tileShift = 0;
+    pDamage->tileRegionValid = TRUE;
 
     pDamage->damageReport = damageReport;
     pDamage->damageDestroy = damageDestroy;
@@ -1824,6 +2124,7 @@ DamageDestroy(DamagePtr pDamage)
     if (pScrPriv->funcs.Destroy)
         pScrPriv->funcs.Destroy (pDamage);
 
+    free(pDamage->tileBits);
     RegionUninit(&pDamage->damage);
     RegionUninit(&pDamage->pendingDamage);
     free(pDamage);
@@ -1836,6 +2137,7 @@ DamageSubtract(DamagePtr pDamage, const RegionPtr pRegion)
     RegionRec pixmapClip;
     DrawablePtr pDrawable = pDamage->pDrawable;
 
+    damageTilesValidateRegion(pDamage);
     RegionSubtract(&pDamage->damage, &pDamage->damage, pRegion);
     if (pDrawable) {
         if (pDrawable->type == DRAWABLE_WINDOW)
@@ -1856,21 +2158,42 @@ DamageSubtract(DamagePtr pDamage, const RegionPtr pRegion)
         if (pDrawable->type != DRAWABLE_WINDOW)
             RegionUninit(&pixmapClip);
     }
+    if (pDamage->tileBits) {
+        memset(pDamage->tileBits, 0, pDamage->tileStride * pDamage->tileRows *
+               sizeof(uint64_t));
+        damageTilesMarkBoxes(pDamage, RegionRects(&pDamage->damage),
+                             RegionNumRects(&pDamage->damage));
+        pDamage->tileRegionValid = TRUE;
+    }
     return RegionNotEmpty(&pDamage->damage);
 }
 
 void
 DamageEmpty(DamagePtr pDamage)
 {
+    if (pDamage->tileBits)
+        memset(pDamage->tileBits, 0, pDamage->tileStride * pDamage->tileRows *
+               sizeof(uint64_t));
+    pDamage->tileRegionValid = TRUE;
     RegionEmpty(&pDamage->damage);
 }
 
 RegionPtr
 DamageRegion(DamagePtr pDamage)
 {
+    damageTilesValidateRegion(pDamage);
     return &pDamage->damage;
 }
 
+Bool
+DamageNotEmpty(DamagePtr pDamage)
+{
+    /* Marking tiles only ever invalidates the region when adding damage */
+    if (!pDamage->tileRegionValid)
+        return TRUE;
+    return RegionNotEmpty(&pDamage->damage);
+}
+
 RegionPtr
 DamagePendingRegion(DamagePtr pDamage)
 {
@@ -1908,6 +2231,41 @@ DamageSetReportAfterOp(DamagePtr pDamage, Bool reportAfter)
     pDamage->reportAfter = reportAfter;
 }
 
+void
+DamageSetCoarsening(DamagePtr pDamage, int maxRects, int tileSize)
+{
+    pDamage->maxRects = maxRects;
+    pDamage->tileSize = tileSize;
+    damageCoarsen(pDamage);
+}
+
+Bool
+DamageSetTileTracking(DamagePtr pDamage, int tileSize)
+{
+    int shift = 1;
+
+    if (tileSize <= 0) {
+        if (pDamage->tileShift)
+            damageTilesFini(pDamage);
+        return TRUE;
+    }
+
+    /* The bitmap can't answer delta or bounding box questions */
+    if (pDamage->damageReport && pDamage->damageLevel != DamageReportNone)
+        return FALSE;
+
+    while ((1 << shift) < tileSize && shift < 12)
+        shift++;
+    if (shift == pDamage->tileShift)
+        return TRUE;
+
+    /* Existing damage is carried over when the bitmap is next sized */
+    if (pDamage->tileShift)
+        damageTilesFini(pDamage);
+    pDamage->tileShift = shift;
+    return TRUE;
+}
+
 DamageScreenFuncsPtr
 DamageGetScreenFuncs(ScreenPtr pScreen)
 {
@@ -1924,21 +2282,21 @@ DamageReportDamage(DamagePtr pDamage, RegionPtr pDamageRegion)
 
     switch (pDamage->damageLevel) {
     case DamageReportRawRegion:
-        RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
+        damageAccumulate(pDamage, pDamageRegion);
         (*pDamage->damageReport) (pDamage, pDamageRegion, pDamage->closure);
         break;
     case DamageReportDeltaRegion:
         RegionNull(&tmpRegion);
         RegionSubtract(&tmpRegion, pDamageRegion, &pDamage->damage);
         if (RegionNotEmpty(&tmpRegion)) {
-            RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
+            damageAccumulate(pDamage, pDamageRegion);
             (*pDamage->damageReport) (pDamage, &tmpRegion, pDamage->closure);
         }
         RegionUninit(&tmpRegion);
         break;
     case DamageReportBoundingBox:
         tmpBox = *RegionExtents(&pDamage->damage);
-        RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
+        damageAccumulate(pDamage, pDamageRegion);
         if (!BOX_SAME(&tmpBox, RegionExtents(&pDamage->damage))) {
             (*pDamage->damageReport) (pDamage, &pDamage->damage,
                                       pDamage->closure);
@@ -1946,14 +2304,14 @@ DamageReportDamage(DamagePtr pDamage, RegionPtr pDamageRegion)
         break;
     case DamageReportNonEmpty:
         was_empty = !RegionNotEmpty(&pDamage->damage);
-        RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
+        damageAccumulate(pDamage, pDamageRegion);
         if (was_empty && RegionNotEmpty(&pDamage->damage)) {
             (*pDamage->damageReport) (pDamage, &pDamage->damage,
                                       pDamage->closure);
         }
         break;
     case DamageReportNone:
-        RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
+        damageAccumulate(pDamage, pDamageRegion);
         break;
     }
 }
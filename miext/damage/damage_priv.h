@@ -0,0 +1,29 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Internal helpers of the damage layer.
+ * (not part of SDK, not available to external modules).
+ */
+#ifndef __XLIBRE_MIEXT_DAMAGE_PRIV_H
+#define __XLIBRE_MIEXT_DAMAGE_PRIV_H
+
+#include <X11/Xdefs.h>
+
+#include "include/regionstr.h"
+
+/*
+ * Bound the number of rectangles in a damage region.
+ *
+ * If pRegion holds more than maxRects rectangles, it is replaced by a
+ * covering made of tileSize x tileSize aligned boxes (aligned to the
+ * region's extents), or by its extents if that is still too many.
+ * The result always contains the original region and never grows
+ * beyond its extents.
+ *
+ * @param pRegion   region to coarsen in place
+ * @param maxRects  rectangle count above which to coarsen, <= 0 disables
+ * @param tileSize  tile edge length, <= 1 collapses straight to extents
+ * @return TRUE if the region was changed
+ */
+Bool damageCoarsenRegion(RegionPtr pRegion, int maxRects, int tileSize);
+
+#endif /* __XLIBRE_MIEXT_DAMAGE_PRIV_H */
@@ -91,6 +91,8 @@ RootlessNativeWindowStateChanged(WindowPtr pWin, unsigned int state)
 
     winRec->is_offscreen = ((state & XP_WINDOW_STATE_OFFSCREEN) != 0);
     winRec->is_obscured = ((state & XP_WINDOW_STATE_OBSCURED) != 0);
+    if (pWin->unhittable != winRec->is_offscreen)
+        windowsRestructuredSerial++;
     pWin->unhittable = winRec->is_offscreen;
 }
 
@@ -1047,6 +1049,8 @@ RootlessReparentWindow(WindowPtr pWin, WindowPtr pPriorParent)
     pTopWin = TopLevelParent(pWin);
     assert(pTopWin != pWin);
 
+    if (pWin->unhittable)
+        windowsRestructuredSerial++;
     pWin->unhittable = FALSE;
 
     DeleteProperty(serverClient, pWin, xa_native_window_id());
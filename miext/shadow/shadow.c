@@ -43,6 +43,14 @@ static DevPrivateKeyRec shadowScrPrivateKeyRec;
     dixLookupPrivate(&(pScr)->devPrivates, shadowScrPrivateKey))
 #define shadowBuf(pScr)            shadowBufPtr pBuf = shadowGetBuf(pScr)
 
+/*
+ * On large screens scattered updates make the damage region expensive to
+ * maintain; track it in tiles instead and let the update hooks work on
+ * the tile granular region.
+ */
+#define SHADOW_TILE_SIZE        64
+#define SHADOW_TILE_MIN_PIXELS  (2560 * 1600)
+
 #define wrap(priv, real, mem) {\
     priv->mem = real->mem; \
     real->mem = shadow##mem; \
@@ -56,12 +64,10 @@ static void
 shadowRedisplay(ScreenPtr pScreen)
 {
     shadowBuf(pScreen);
-    RegionPtr pRegion;
 
     if (!pBuf || !pBuf->pDamage || !pBuf->update)
         return;
-    pRegion = DamageRegion(pBuf->pDamage);
-    if (RegionNotEmpty(pRegion)) {
+    if (DamageNotEmpty(pBuf->pDamage)) {
         (*pBuf->update) (pScreen, pBuf);
         DamageEmpty(pBuf->pDamage);
     }
@@ -172,6 +178,9 @@ shadowAdd(ScreenPtr pScreen, PixmapPtr pPixmap, ShadowUpdateProc update,
     pBuf->randr = randr;
     pBuf->closure = closure;
     pBuf->pPixmap = pPixmap;
+    DamageSetTileTracking(pBuf->pDamage,
+                          pPixmap->drawable.width * pPixmap->drawable.height >=
+                          SHADOW_TILE_MIN_PIXELS ? SHADOW_TILE_SIZE : 0);
     DamageRegister(&pPixmap->drawable, pBuf->pDamage);
     return TRUE;
 }
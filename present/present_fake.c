@@ -21,16 +21,33 @@
  */
 #include <dix-config.h>
 
+#include <errno.h>
+#include <unistd.h>
+#if defined(HAVE_SYS_TIMERFD_H) && defined(MONOTONIC_CLOCK)
+#define PRESENT_FAKE_TIMERFD 1
+#include <sys/timerfd.h>
+#endif
+
 #include "include/list.h"
 #include "present/present_priv.h"
 
-static struct xorg_list fake_vblank_queue;
+/*
+ * Screens without a CRTC get a vblank clock of their own, ticking every
+ * fake_interval microseconds on the GetTimeInMicros() timeline.  Pending
+ * events are kept in msc order and a single deadline is armed for the
+ * earliest one; when it expires everything due is notified with the UST
+ * and MSC of that tick, so clients see evenly spaced frames however late
+ * the server got to run.
+ *
+ * The deadline is a CLOCK_MONOTONIC timerfd where available, the clock
+ * GetTimeInMicros() uses too, since OsTimers only have millisecond
+ * resolution.
+ */
 
 typedef struct present_fake_vblank {
     struct xorg_list            list;
     uint64_t                    event_id;
-    OsTimerPtr                  timer;
-    ScreenPtr                   screen;
+    uint64_t                    msc;
 } present_fake_vblank_rec, *present_fake_vblank_ptr;
 
 int
@@ -38,18 +55,41 @@ present_fake_get_ust_msc(ScreenPtr screen, uint64_t *ust, uint64_t *msc)
 {
     present_screen_priv_ptr screen_priv = present_screen_priv(screen);
 
-    *ust = GetTimeInMicros();
-    *msc = (*ust + screen_priv->fake_interval / 2) / screen_priv->fake_interval;
+    /* like a real CRTC, report the last vblank */
+    *msc = GetTimeInMicros() / screen_priv->fake_interval;
+    *ust = *msc * screen_priv->fake_interval;
     return Success;
 }
 
+static void present_fake_arm(ScreenPtr screen);
+
 static void
-present_fake_notify(ScreenPtr screen, uint64_t event_id)
+present_fake_tick(ScreenPtr screen)
 {
+    present_screen_priv_ptr     screen_priv = present_screen_priv(screen);
+    present_fake_vblank_ptr     fake_vblank, tmp;
+    struct xorg_list            due;
     uint64_t                    ust, msc;
 
     present_fake_get_ust_msc(screen, &ust, &msc);
-    present_event_notify(event_id, ust, msc);
+    screen_priv->fake_armed_msc = 0;
+
+    /* notifying may queue or abort others, so take the due ones off first */
+    xorg_list_init(&due);
+    xorg_list_for_each_entry_safe(fake_vblank, tmp, &screen_priv->fake_queue, list) {
+        if (fake_vblank->msc > msc)
+            break;
+        xorg_list_del(&fake_vblank->list);
+        xorg_list_append(&fake_vblank->list, &due);
+    }
+
+    xorg_list_for_each_entry_safe(fake_vblank, tmp, &due, list) {
+        xorg_list_del(&fake_vblank->list);
+        present_event_notify(fake_vblank->event_id, ust, msc);
+        free(fake_vblank);
+    }
+
+    present_fake_arm(screen);
 }
 
 static CARD32
@@ -57,23 +97,71 @@ present_fake_do_timer(OsTimerPtr timer,
                       CARD32 time,
                       void *arg)
 {
-    present_fake_vblank_ptr     fake_vblank = arg;
-
-    present_fake_notify(fake_vblank->screen, fake_vblank->event_id);
-    xorg_list_del(&fake_vblank->list);
-    TimerFree(fake_vblank->timer);
-    free(fake_vblank);
+    present_fake_tick(arg);
     return 0;
 }
 
+#ifdef PRESENT_FAKE_TIMERFD
+static void
+present_fake_timer_fd_notify(int fd, int ready, void *data)
+{
+    uint64_t                    expirations;
+
+    if (read(fd, &expirations, sizeof(expirations)) < 0 && errno == EAGAIN)
+        return;
+    present_fake_tick(data);
+}
+#endif
+
+static void
+present_fake_arm(ScreenPtr screen)
+{
+    present_screen_priv_ptr     screen_priv = present_screen_priv(screen);
+    present_fake_vblank_ptr     first;
+    uint64_t                    deadline, now;
+
+    if (xorg_list_is_empty(&screen_priv->fake_queue))
+        return;
+
+    first = xorg_list_first_entry(&screen_priv->fake_queue,
+                                  present_fake_vblank_rec, list);
+    if (first->msc == screen_priv->fake_armed_msc)
+        return;
+    screen_priv->fake_armed_msc = first->msc;
+    deadline = first->msc * screen_priv->fake_interval;
+
+#ifdef PRESENT_FAKE_TIMERFD
+    if (screen_priv->fake_timer_fd >= 0) {
+        struct itimerspec its = {
+            .it_value = {
+                .tv_sec = deadline / 1000000,
+                .tv_nsec = (deadline % 1000000) * 1000,
+            },
+        };
+
+        if (timerfd_settime(screen_priv->fake_timer_fd, TFD_TIMER_ABSTIME,
+                            &its, NULL) == 0)
+            return;
+    }
+#endif
+
+    /* round up, firing early would find nothing due */
+    now = GetTimeInMicros();
+    screen_priv->fake_timer = TimerSet(screen_priv->fake_timer, 0,
+                                       deadline > now ?
+                                       (deadline - now + 999) / 1000 : 1,
+                                       present_fake_do_timer, screen);
+}
+
 void
 present_fake_abort_vblank(ScreenPtr screen, uint64_t event_id, uint64_t msc)
 {
+    present_screen_priv_ptr     screen_priv = present_screen_priv(screen);
     present_fake_vblank_ptr     fake_vblank, tmp;
 
-    xorg_list_for_each_entry_safe(fake_vblank, tmp, &fake_vblank_queue, list) {
+    /* the deadline is left alone, ticking once for nothing is harmless */
+    xorg_list_for_each_entry_safe(fake_vblank, tmp, &screen_priv->fake_queue, list) {
         if (fake_vblank->event_id == event_id) {
-            TimerFree(fake_vblank->timer); /* TimerFree will call TimerCancel() */
             xorg_list_del(&fake_vblank->list);
             free (fake_vblank);
             break;
@@ -87,13 +175,13 @@ present_fake_queue_vblank(ScreenPtr     screen,
                           uint64_t      msc)
 {
     present_screen_priv_ptr     screen_priv = present_screen_priv(screen);
-    uint64_t                    ust = msc * screen_priv->fake_interval;
-    uint64_t                    now = GetTimeInMicros();
-    INT32                       delay = ((int64_t) (ust - now)) / 1000;
     present_fake_vblank_ptr     fake_vblank;
+    struct xorg_list            *pos;
+    uint64_t                    ust, now_msc;
 
-    if (delay <= 0) {
-        present_fake_notify(screen, event_id);
+    present_fake_get_ust_msc(screen, &ust, &now_msc);
+    if (msc <= now_msc) {
+        present_event_notify(event_id, ust, now_msc);
         return Success;
     }
 
@@ -101,15 +189,19 @@ present_fake_queue_vblank(ScreenPtr     screen,
     if (!fake_vblank)
         return BadAlloc;
 
-    fake_vblank->screen = screen;
     fake_vblank->event_id = event_id;
-    fake_vblank->timer = TimerSet(NULL, 0, delay, present_fake_do_timer, fake_vblank);
-    if (!fake_vblank->timer) {
-        free(fake_vblank);
-        return BadAlloc;
+    fake_vblank->msc = msc;
+
+    /* most events are for the next tick, so look from the back */
+    for (pos = screen_priv->fake_queue.prev;
+         pos != &screen_priv->fake_queue;
+         pos = pos->prev) {
+        if (container_of(pos, present_fake_vblank_rec, list)->msc <= msc)
+            break;
     }
+    xorg_list_add(&fake_vblank->list, pos);
 
-    xorg_list_add(&fake_vblank->list, &fake_vblank_queue);
+    present_fake_arm(screen);
 
     return Success;
 }
@@ -137,10 +229,38 @@ present_fake_screen_init(ScreenPtr screen)
             fake_fps = 60;
     }
     screen_priv->fake_interval = 1000000 / fake_fps;
+
+    xorg_list_init(&screen_priv->fake_queue);
+    screen_priv->fake_armed_msc = 0;
+    screen_priv->fake_timer = NULL;
+    screen_priv->fake_timer_fd = -1;
+#ifdef PRESENT_FAKE_TIMERFD
+    screen_priv->fake_timer_fd = timerfd_create(CLOCK_MONOTONIC,
+                                                TFD_NONBLOCK | TFD_CLOEXEC);
+    if (screen_priv->fake_timer_fd >= 0 &&
+        !SetNotifyFd(screen_priv->fake_timer_fd, present_fake_timer_fd_notify,
+                     X_NOTIFY_READ, screen)) {
+        close(screen_priv->fake_timer_fd);
+        screen_priv->fake_timer_fd = -1;
+    }
+#endif
 }
 
 void
-present_fake_queue_init(void)
+present_fake_screen_fini(ScreenPtr screen)
 {
-    xorg_list_init(&fake_vblank_queue);
+    present_screen_priv_ptr     screen_priv = present_screen_priv(screen);
+    present_fake_vblank_ptr     fake_vblank, tmp;
+
+    xorg_list_for_each_entry_safe(fake_vblank, tmp, &screen_priv->fake_queue, list) {
+        xorg_list_del(&fake_vblank->list);
+        free(fake_vblank);
+    }
+    TimerFree(screen_priv->fake_timer);
+    screen_priv->fake_timer = NULL;
+    if (screen_priv->fake_timer_fd >= 0) {
+        RemoveNotifyFd(screen_priv->fake_timer_fd);
+        close(screen_priv->fake_timer_fd);
+        screen_priv->fake_timer_fd = -1;
+    }
 }
@@ -68,6 +68,7 @@ struct present_notify {
 struct present_vblank {
     struct xorg_list    window_list;
     struct xorg_list    event_queue;
+    struct xorg_list    event_hash;     /* scmd lookup by event_id */
     ScreenPtr           screen;
     WindowPtr           window;
     PixmapPtr           pixmap;
@@ -172,6 +173,10 @@ struct present_screen_priv {
     uint64_t                    unflip_event_id;
 
     uint32_t                    fake_interval;
+    struct xorg_list            fake_queue;     /* in msc order */
+    uint64_t                    fake_armed_msc;
+    OsTimerPtr                  fake_timer;
+    int                         fake_timer_fd;
 
     /* Currently active flipped pixmap and fence */
     RRCrtcPtr                   flip_crtc;
@@ -380,7 +385,7 @@ void
 present_fake_screen_init(ScreenPtr screen);
 
 void
-present_fake_queue_init(void);
+present_fake_screen_fini(ScreenPtr screen);
 
 /*
  * present_fence.c
@@ -41,6 +41,28 @@ static uint64_t present_scmd_event_id;
 static struct xorg_list present_exec_queue;
 static struct xorg_list present_flip_queue;
 
+/* Every vblank with an event_id, hashed on it, so that event notifies and
+ * aborts don't have to walk the queues when many windows are presenting.
+ * event_ids are handed out sequentially, so the low bits spread them well.
+ */
+#define PRESENT_EVENT_HASH_SIZE 256
+
+static struct xorg_list present_event_hash[PRESENT_EVENT_HASH_SIZE];
+
+static present_vblank_ptr
+present_scmd_find_vblank(uint64_t event_id)
+{
+    present_vblank_ptr  vblank;
+
+    xorg_list_for_each_entry(vblank,
+                             &present_event_hash[event_id % PRESENT_EVENT_HASH_SIZE],
+                             event_hash) {
+        if (vblank->event_id == event_id)
+            return vblank;
+    }
+    return NULL;
+}
+
 static void
 present_execute(present_vblank_ptr vblank, uint64_t ust, uint64_t crtc_msc);
 
@@ -392,21 +414,14 @@ present_event_notify(uint64_t event_id, uint64_t ust, uint64_t msc)
     if (!event_id)
         return;
     DebugPresent(("\te %" PRIu64 " ust %" PRIu64 " msc %" PRIu64 "\n", event_id, ust, msc));
-    xorg_list_for_each_entry(vblank, &present_exec_queue, event_queue) {
-        int64_t match = event_id - vblank->event_id;
-        if (match == 0) {
+    /* Only vblanks still sitting on the exec or flip queue want the event */
+    vblank = present_scmd_find_vblank(event_id);
+    if (vblank && !xorg_list_is_empty(&vblank->event_queue)) {
+        if (vblank->queued)
             present_execute(vblank, ust, msc);
-            return;
-        }
-    }
-    xorg_list_for_each_entry(vblank, &present_flip_queue, event_queue) {
-        if (vblank->event_id == event_id) {
-            if (vblank->queued)
-                present_execute(vblank, ust, msc);
-            else
-                present_flip_notify(vblank, ust, msc);
-            return;
-        }
+        else
+            present_flip_notify(vblank, ust, msc);
+        return;
     }
 
     DIX_FOR_EACH_SCREEN({
@@ -849,6 +864,8 @@ present_scmd_pixmap(WindowPtr window,
         return BadAlloc;
 
     vblank->event_id = ++present_scmd_event_id;
+    xorg_list_add(&vblank->event_hash,
+                  &present_event_hash[vblank->event_id % PRESENT_EVENT_HASH_SIZE]);
 
     /* The soonest presentation is crtc_msc+2 if TearFree is already flipping */
     if (vblank->reason == PRESENT_FLIP_REASON_DRIVER_TEARFREE_FLIPPING &&
@@ -887,20 +904,10 @@ present_scmd_abort_vblank(ScreenPtr screen, WindowPtr window, RRCrtcPtr crtc, ui
         (*screen_priv->info->abort_vblank) (crtc, event_id, msc);
     }
 
-    xorg_list_for_each_entry(vblank, &present_exec_queue, event_queue) {
-        int64_t match = event_id - vblank->event_id;
-        if (match == 0) {
-            xorg_list_del(&vblank->event_queue);
-            vblank->queued = FALSE;
-            return;
-        }
-    }
-    xorg_list_for_each_entry(vblank, &present_flip_queue, event_queue) {
-        if (vblank->event_id == event_id) {
-            xorg_list_del(&vblank->event_queue);
-            vblank->queued = FALSE;
-            return;
-        }
+    vblank = present_scmd_find_vblank(event_id);
+    if (vblank && !xorg_list_is_empty(&vblank->event_queue)) {
+        xorg_list_del(&vblank->event_queue);
+        vblank->queued = FALSE;
     }
 }
 
@@ -943,6 +950,7 @@ present_init(void)
 {
     xorg_list_init(&present_exec_queue);
     xorg_list_init(&present_flip_queue);
-    present_fake_queue_init();
+    for (int i = 0; i < PRESENT_EVENT_HASH_SIZE; i++)
+        xorg_list_init(&present_event_hash[i]);
     return TRUE;
 }
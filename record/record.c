@@ -65,9 +65,11 @@ and Jim Haggerty of Metheus.
 static RESTYPE RTContext;       /* internal resource type for Record contexts */
 
 /* How many bytes of protocol data to buffer in a context. Don't set to less
- * than 32.
+ * than 32. The buffer grows up to REPLY_BUF_MAX_SIZE when recording a busy
+ * stream keeps overflowing it, and drops back when the context is disabled.
  */
 #define REPLY_BUF_SIZE 1024
+#define REPLY_BUF_MAX_SIZE (1024 * 1024)
 
 /* Record Context structure */
 
@@ -80,8 +82,12 @@ typedef struct {
     char elemHeaders;           /* element header flags (time/seq no.) */
     char bufCategory;           /* category of protocol in replyBuffer */
     int numBufBytes;            /* number of bytes in replyBuffer */
-    char replyBuffer[REPLY_BUF_SIZE];   /* buffered recorded protocol */
+    int sizeBuf;                /* allocated size of replyBuffer */
+    char *replyBuffer;          /* buffered recorded protocol */
     int inFlush;                /*  are we inside RecordFlushReplyBuffer */
+    Bool lastClientValid;       /* is the lookup below current? */
+    XID lastClient;             /* client last looked up on this context */
+    struct _RecordClientsAndProtocolRec *pLastRCAP;     /* ... and its RCAP */
 } RecordContextRec, *RecordContextPtr;
 
 /*  RecordMinorOpRec - to hold minor opcode selections for extension requests
@@ -120,8 +126,18 @@ typedef struct _RecordClientsAndProtocolRec {
     unsigned int clientStarted:1;       /* record new client connections? */
     unsigned int clientDied:1;  /* record client disconnections? */
     unsigned int clientIDsSeparatelyAllocated:1;        /* pClientIDs calloced? */
+    /* the sets above flattened into bitmaps for the recording hooks */
+    CARD32 requestMajorBits[8];
+    CARD32 replyMajorBits[8];
+    CARD32 deviceEventBits[8];
+    CARD32 deliveredEventBits[8];
+    CARD32 errorBits[8];
+    CARD32 *pRequestMinorBits;  /* 256 minor bits per extension major */
+    CARD32 *pReplyMinorBits;
 } RecordClientsAndProtocolRec, *RecordClientsAndProtocolPtr;
 
+#define RecordBitIsSet(bits, n) ((bits)[(n) >> 5] & (1U << ((n) & 31)))
+
 /* how much bigger to make pRCAP->pClientIDs when reallocing */
 #define CLIENT_ARRAY_GROWTH_INCREMENT 4
 
@@ -231,15 +247,20 @@ RecordFindContextOnAllContexts(RecordContextPtr pContext)
  *	to the recording client, and the number of buffered bytes is set to
  *	zero.  If len1 is not zero, data1/len1 are then written to the
  *	recording client, and similarly for data2/len2 (written after
- *	data1/len1).
+ *	data1/len1).  If the recording client is gone, buffered protocol
+ *	is dropped instead.
  */
 static void
 RecordFlushReplyBuffer(RecordContextPtr pContext,
                        void *data1, int len1, void *data2, int len2)
 {
-    if (!pContext->pRecordingClient || pContext->pRecordingClient->clientGone ||
-        pContext->inFlush)
+    if (pContext->inFlush)
+        return;
+    if (!pContext->pRecordingClient || pContext->pRecordingClient->clientGone) {
+        /* nobody to send it to; don't let it leak to the next recorder */
+        pContext->numBufBytes = 0;
         return;
+    }
     ++pContext->inFlush;
     if (pContext->numBufBytes)
         WriteToClient(pContext->pRecordingClient, pContext->numBufBytes,
@@ -252,6 +273,39 @@ RecordFlushReplyBuffer(RecordContextPtr pContext,
     --pContext->inFlush;
 }                               /* RecordFlushReplyBuffer */
 
+/* RecordGrowReplyBuffer
+ *
+ * Arguments:
+ *	pContext is the context whose buffer overflowed.
+ *	needed is the number of bytes the buffer should be able to hold.
+ *
+ * Returns: nothing.
+ *
+ * Side Effects:
+ *	The context's buffer is doubled until it can hold needed bytes,
+ *	unless that would exceed REPLY_BUF_MAX_SIZE.  On allocation failure
+ *	the buffer is left as it was.
+ */
+static void
+RecordGrowReplyBuffer(RecordContextPtr pContext, int needed)
+{
+    int size = pContext->sizeBuf;
+    char *buf;
+
+    if (needed > REPLY_BUF_MAX_SIZE)
+        return;
+    while (size < needed)
+        size <<= 1;
+    if (size > REPLY_BUF_MAX_SIZE)
+        size = REPLY_BUF_MAX_SIZE;
+
+    buf = realloc(pContext->replyBuffer, size);
+    if (!buf)
+        return;
+    pContext->replyBuffer = buf;
+    pContext->sizeBuf = size;
+}                               /* RecordGrowReplyBuffer */
+
 /* RecordAProtocolElement
  *
  * Arguments:
@@ -373,9 +427,17 @@ RecordAProtocolElement(RecordContextPtr pContext, ClientPtr pClient,
 
     numElemHeaders *= 4;
 
+    /* a busy stream keeps overflowing the buffer; make room rather than
+     * sending lots of small replies
+     */
+
+    if (pContext->sizeBuf - pContext->numBufBytes < datalen + numElemHeaders)
+        RecordGrowReplyBuffer(pContext,
+                              pContext->numBufBytes + datalen + numElemHeaders);
+
     /* if space available >= space needed, buffer the data */
 
-    if (REPLY_BUF_SIZE - pContext->numBufBytes >= datalen + numElemHeaders) {
+    if (pContext->sizeBuf - pContext->numBufBytes >= datalen + numElemHeaders) {
         if (numElemHeaders) {
             memcpy(pContext->replyBuffer + pContext->numBufBytes,
                    elemHeaderData, numElemHeaders);
@@ -436,6 +498,124 @@ RecordFindClientOnContext(RecordContextPtr pContext,
     return NULL;
 }                               /* RecordFindClientOnContext */
 
+/* RecordLookupClientOnContext
+ *
+ * Same as RecordFindClientOnContext without pposition, but remembers the
+ * last answer, since the recording hooks keep asking about the same
+ * client.  Anything that changes which clients are on which RCAP must
+ * call RecordInvalidateClientLookup.
+ */
+static RecordClientsAndProtocolPtr
+RecordLookupClientOnContext(RecordContextPtr pContext, XID clientspec)
+{
+    if (!pContext->lastClientValid || pContext->lastClient != clientspec) {
+        pContext->pLastRCAP =
+            RecordFindClientOnContext(pContext, clientspec, NULL);
+        pContext->lastClient = clientspec;
+        pContext->lastClientValid = TRUE;
+    }
+    return pContext->pLastRCAP;
+}                               /* RecordLookupClientOnContext */
+
+static void
+RecordInvalidateClientLookup(RecordContextPtr pContext)
+{
+    pContext->lastClientValid = FALSE;
+    pContext->pLastRCAP = NULL;
+}                               /* RecordInvalidateClientLookup */
+
+/* RecordIsMemberOfMinorOps
+ *
+ * Arguments:
+ *	pMinorOpInfo is an RCAP's extension request or reply selection.
+ *	minorBits is the same selection as a bitmap, or NULL.
+ *	majorop and minorop identify an extension request or reply.
+ *
+ * Returns: TRUE if the request or reply is selected, else FALSE.
+ *
+ * Side Effects: none.
+ */
+static Bool
+RecordIsMemberOfMinorOps(RecordMinorOpPtr pMinorOpInfo, CARD32 *minorBits,
+                         int majorop, int minorop)
+{
+    int numMinOpInfo;
+
+    if (minorBits && minorop < 256)
+        return RecordBitIsSet(minorBits + (majorop - 128) * 8, minorop) != 0;
+
+    assert(pMinorOpInfo);
+    numMinOpInfo = pMinorOpInfo->count;
+    pMinorOpInfo++;
+    assert(numMinOpInfo);
+    for (; numMinOpInfo; numMinOpInfo--, pMinorOpInfo++) {
+        if (majorop >= pMinorOpInfo->major.first &&
+            majorop <= pMinorOpInfo->major.last &&
+            RecordIsMemberOfSet(pMinorOpInfo->major.pMinOpSet, minorop))
+            return TRUE;
+    }
+    return FALSE;
+}                               /* RecordIsMemberOfMinorOps */
+
+/* RecordSetToBits
+ *
+ * Arguments:
+ *	pSet is a set of values, or NULL.
+ *	bits is an array of 8 CARD32s.
+ *
+ * Returns: nothing.
+ *
+ * Side Effects:
+ *	The members of pSet below 256 are set in bits.
+ */
+static void
+RecordSetToBits(RecordSetPtr pSet, CARD32 *bits)
+{
+    RecordSetIteratePtr pIter = NULL;
+    RecordSetInterval interval;
+
+    if (!pSet)
+        return;
+    while ((pIter = RecordIterateSet(pSet, pIter, &interval))) {
+        for (unsigned int i = interval.first; i <= interval.last && i < 256; i++)
+            bits[i >> 5] |= 1U << (i & 31);
+    }
+}                               /* RecordSetToBits */
+
+/* RecordMinorOpsToBits
+ *
+ * Arguments:
+ *	pMinorOpInfo is an RCAP's extension request or reply selection.
+ *
+ * Returns:
+ *	A bitmap of 256 minor opcodes for each of the extension major
+ *	opcodes 128-255, or NULL if pMinorOpInfo is NULL or on allocation
+ *	failure, in which case the selection has to be consulted directly.
+ *
+ * Side Effects: none.
+ */
+static CARD32 *
+RecordMinorOpsToBits(RecordMinorOpPtr pMinorOpInfo)
+{
+    CARD32 *bits;
+    int numMinOpInfo;
+
+    if (!pMinorOpInfo)
+        return NULL;
+    bits = calloc(128 * 8, sizeof(CARD32));
+    if (!bits)
+        return NULL;
+
+    numMinOpInfo = pMinorOpInfo->count;
+    for (pMinorOpInfo++; numMinOpInfo; numMinOpInfo--, pMinorOpInfo++) {
+        for (int major = max(pMinorOpInfo->major.first, 128);
+             major <= min(pMinorOpInfo->major.last, 255); major++)
+            RecordSetToBits(pMinorOpInfo->major.pMinOpSet,
+                            bits + (major - 128) * 8);
+    }
+    return bits;
+}                               /* RecordMinorOpsToBits */
+
 /* RecordABigRequest
  *
  * Arguments:
@@ -514,45 +694,19 @@ RecordARequest(ClientPtr client)
     majorop = stuff->reqType;
     for (i = 0; i < numEnabledContexts; i++) {
         pContext = ppAllContexts[i];
-        pRCAP = RecordFindClientOnContext(pContext, client->clientAsMask, NULL);
-        if (pRCAP && pRCAP->pRequestMajorOpSet &&
-            RecordIsMemberOfSet(pRCAP->pRequestMajorOpSet, majorop)) {
-            if (majorop <= 127) {       /* core request */
-
-                if (client->req_len == 0)
-                    RecordABigRequest(pContext, client, stuff);
-                else
-                    RecordAProtocolElement(pContext, client, XRecordFromClient,
-                                           (void *) stuff,
-                                           client->req_len << 2, 0, 0);
-            }
-            else {              /* extension, check minor opcode */
-
-                int minorop = client->minorOp;
-                int numMinOpInfo;
-                RecordMinorOpPtr pMinorOpInfo = pRCAP->pRequestMinOpInfo;
-
-                assert(pMinorOpInfo);
-                numMinOpInfo = pMinorOpInfo->count;
-                pMinorOpInfo++;
-                assert(numMinOpInfo);
-                for (; numMinOpInfo; numMinOpInfo--, pMinorOpInfo++) {
-                    if (majorop >= pMinorOpInfo->major.first &&
-                        majorop <= pMinorOpInfo->major.last &&
-                        RecordIsMemberOfSet(pMinorOpInfo->major.pMinOpSet,
-                                            minorop)) {
-                        if (client->req_len == 0)
-                            RecordABigRequest(pContext, client, stuff);
-                        else
-                            RecordAProtocolElement(pContext, client,
-                                                   XRecordFromClient,
-                                                   (void *) stuff,
-                                                   client->req_len << 2, 0, 0);
-                        break;
-                    }
-                }               /* end for each minor op info */
-            }                   /* end extension request */
-        }                       /* end this RCAP wants this major opcode */
+        pRCAP = RecordLookupClientOnContext(pContext, client->clientAsMask);
+        if (pRCAP && RecordBitIsSet(pRCAP->requestMajorBits, majorop) &&
+            (majorop <= 127 ||  /* core request */
+             RecordIsMemberOfMinorOps(pRCAP->pRequestMinOpInfo,
+                                      pRCAP->pRequestMinorBits,
+                                      majorop, client->minorOp))) {
+            if (client->req_len == 0)
+                RecordABigRequest(pContext, client, stuff);
+            else
+                RecordAProtocolElement(pContext, client, XRecordFromClient,
+                                       (void *) stuff,
+                                       client->req_len << 2, 0, 0);
+        }                       /* end this RCAP wants this request */
     }                           /* end for each context */
     pClientPriv = RecordClientPrivate(client);
     assert(pClientPriv);
@@ -589,7 +743,7 @@ RecordAReply(CallbackListPtr *pcbl, void *nulldata, void *calldata)
 
     for (eci = 0; eci < numEnabledContexts; eci++) {
         pContext = ppAllContexts[eci];
-        pRCAP = RecordFindClientOnContext(pContext, client->clientAsMask, NULL);
+        pRCAP = RecordLookupClientOnContext(pContext, client->clientAsMask);
         if (pRCAP) {
             int majorop = client->majorOp;
 
@@ -601,42 +755,18 @@ RecordAReply(CallbackListPtr *pcbl, void *nulldata, void *calldata)
                 if (!pri->bytesRemaining)
                     pContext->continuedReply = 0;
             }
-            else if (pri->startOfReply && pRCAP->pReplyMajorOpSet &&
-                     RecordIsMemberOfSet(pRCAP->pReplyMajorOpSet, majorop)) {
-                if (majorop <= 127) {   /* core reply */
-                    RecordAProtocolElement(pContext, client, XRecordFromServer,
-                                           (void *) pri->replyData,
-                                           pri->dataLenBytes, 0,
-                                           pri->bytesRemaining);
-                    if (pri->bytesRemaining)
-                        pContext->continuedReply = 1;
-                }
-                else {          /* extension, check minor opcode */
-
-                    int minorop = client->minorOp;
-                    int numMinOpInfo;
-                    RecordMinorOpPtr pMinorOpInfo = pRCAP->pReplyMinOpInfo;
-
-                    assert(pMinorOpInfo);
-                    numMinOpInfo = pMinorOpInfo->count;
-                    pMinorOpInfo++;
-                    assert(numMinOpInfo);
-                    for (; numMinOpInfo; numMinOpInfo--, pMinorOpInfo++) {
-                        if (majorop >= pMinorOpInfo->major.first &&
-                            majorop <= pMinorOpInfo->major.last &&
-                            RecordIsMemberOfSet(pMinorOpInfo->major.pMinOpSet,
-                                                minorop)) {
-                            RecordAProtocolElement(pContext, client,
-                                                   XRecordFromServer,
-                                                   (void *) pri->replyData,
-                                                   pri->dataLenBytes, 0,
-                                                   pri->bytesRemaining);
-                            if (pri->bytesRemaining)
-                                pContext->continuedReply = 1;
-                            break;
-                        }
-                    }           /* end for each minor op info */
-                }               /* end extension reply */
+            else if (pri->startOfReply &&
+                     RecordBitIsSet(pRCAP->replyMajorBits, majorop) &&
+                     (majorop <= 127 ||         /* core reply */
+                      RecordIsMemberOfMinorOps(pRCAP->pReplyMinOpInfo,
+                                               pRCAP->pReplyMinorBits,
+                                               majorop, client->minorOp))) {
+                RecordAProtocolElement(pContext, client, XRecordFromServer,
+                                       (void *) pri->replyData,
+                                       pri->dataLenBytes, 0,
+                                       pri->bytesRemaining);
+                if (pri->bytesRemaining)
+                    pContext->continuedReply = 1;
             }                   /* end continued reply vs. start of reply */
         }                       /* end client is registered on this context */
     }                           /* end for each context */
@@ -669,8 +799,7 @@ RecordADeliveredEventOrError(CallbackListPtr *pcbl, void *nulldata,
 
     for (eci = 0; eci < numEnabledContexts; eci++) {
         pContext = ppAllContexts[eci];
-        pRCAP = RecordFindClientOnContext(pContext, pClient->clientAsMask,
-                                          NULL);
+        pRCAP = RecordLookupClientOnContext(pContext, pClient->clientAsMask);
         if (pRCAP && (pRCAP->pDeliveredEventSet || pRCAP->pErrorSet)) {
             int ev;             /* event index */
             xEvent *pev = pei->events;
@@ -679,13 +808,12 @@ RecordADeliveredEventOrError(CallbackListPtr *pcbl, void *nulldata,
                 int recordit = 0;
 
                 if (pRCAP->pErrorSet) {
-                    recordit = RecordIsMemberOfSet(pRCAP->pErrorSet,
-                                                   ((xError *) (pev))->
-                                                   errorCode);
+                    recordit = RecordBitIsSet(pRCAP->errorBits,
+                                              ((xError *) (pev))->errorCode);
                 }
                 else if (pRCAP->pDeliveredEventSet) {
-                    recordit = RecordIsMemberOfSet(pRCAP->pDeliveredEventSet,
-                                                   pev->u.u.type & 0177);
+                    recordit = RecordBitIsSet(pRCAP->deliveredEventBits,
+                                              pev->u.u.type & 0177);
                 }
                 if (recordit) {
                     xEvent swappedEvent;
@@ -713,7 +841,7 @@ RecordSendProtocolEvents(RecordClientsAndProtocolPtr pRCAP,
     int ev;                     /* event index */
 
     for (ev = 0; ev < count; ev++, pev++) {
-        if (RecordIsMemberOfSet(pRCAP->pDeviceEventSet, pev->u.u.type & 0177)) {
+        if (RecordBitIsSet(pRCAP->deviceEventBits, pev->u.u.type & 0177)) {
             xEvent swappedEvent;
             xEvent *pEvToRecord = pev;
 
@@ -805,8 +933,8 @@ RecordADeviceEvent(CallbackListPtr *pcbl, void *nulldata, void *calldata)
 /* RecordFlushAllContexts
  *
  * Arguments:
- *	pcbl is &FlushCallback.
- *	nulldata and calldata are NULL.
+ *	blockData is NULL.
+ *	timeout is the block handler timeout, unused.
  *
  * Returns: nothing.
  *
@@ -815,8 +943,7 @@ RecordADeviceEvent(CallbackListPtr *pcbl, void *nulldata, void *calldata)
  *	the recording clients.
  */
 static void
-RecordFlushAllContexts(CallbackListPtr *pcbl,
-                       void *nulldata, void *calldata)
+RecordFlushAllContexts(void *blockData, void *timeout)
 {
     int eci;                    /* enabled context index */
     RecordContextPtr pContext;
@@ -909,12 +1036,13 @@ RecordInstallHooks(RecordClientsAndProtocolPtr pRCAP, XID oneclient)
             return BadAlloc;
         if (!AddCallback(&ReplyCallback, RecordAReply, NULL))
             return BadAlloc;
-        if (!AddCallback(&FlushCallback, RecordFlushAllContexts, NULL))
-            return BadAlloc;
-        /* Alternate context flushing scheme: delete the line above
-         * and call RegisterBlockAndWakeupHandlers here passing
-         * RecordFlushAllContexts.  Is this any better?
+        /* Flush once per dispatch cycle, right before output is written
+         * out, rather than every time any client's output gets flushed.
          */
+        if (!RegisterBlockAndWakeupHandlers(RecordFlushAllContexts,
+                                            (ServerWakeupHandlerProcPtr) NoopDDA,
+                                            NULL))
+            return BadAlloc;
     }
     return Success;
 }                               /* RecordInstallHooks */
@@ -1004,13 +1132,11 @@ RecordUninstallHooks(RecordClientsAndProtocolPtr pRCAP, XID oneclient)
         DeleteCallback(&EventCallback, RecordADeliveredEventOrError, NULL);
         DeleteCallback(&DeviceEventCallback, RecordADeviceEvent, NULL);
         DeleteCallback(&ReplyCallback, RecordAReply, NULL);
-        DeleteCallback(&FlushCallback, RecordFlushAllContexts, NULL);
-        /* Alternate context flushing scheme: delete the line above
-         * and call RemoveBlockAndWakeupHandlers here passing
-         * RecordFlushAllContexts.  Is this any better?
-         */
-        /* Having deleted the callback, call it one last time. -gildea */
-        RecordFlushAllContexts(&FlushCallback, NULL, NULL);
+        RemoveBlockAndWakeupHandlers(RecordFlushAllContexts,
+                                     (ServerWakeupHandlerProcPtr) NoopDDA,
+                                     NULL);
+        /* Having deleted the handler, call it one last time. -gildea */
+        RecordFlushAllContexts(NULL, NULL);
     }
 }                               /* RecordUninstallHooks */
 
@@ -1033,6 +1159,7 @@ RecordUninstallHooks(RecordClientsAndProtocolPtr pRCAP, XID oneclient)
 static void
 RecordDeleteClientFromRCAP(RecordClientsAndProtocolPtr pRCAP, int position)
 {
+    RecordInvalidateClientLookup(pRCAP->pContext);
     if (pRCAP->pContext->pRecordingClient)
         RecordUninstallHooks(pRCAP, pRCAP->pClientIDs[position]);
     if (position != pRCAP->numClients - 1)
@@ -1054,6 +1181,8 @@ RecordDeleteClientFromRCAP(RecordClientsAndProtocolPtr pRCAP, int position)
         /* free the RCAP */
         if (pRCAP->clientIDsSeparatelyAllocated)
             free(pRCAP->pClientIDs);
+        free(pRCAP->pRequestMinorBits);
+        free(pRCAP->pReplyMinorBits);
         free(pRCAP);
     }
 }                               /* RecordDeleteClientFromRCAP */
@@ -1101,6 +1230,7 @@ RecordAddClientToRCAP(RecordClientsAndProtocolPtr pRCAP, XID clientspec)
         }
     }
     pRCAP->pClientIDs[pRCAP->numClients++] = clientspec;
+    RecordInvalidateClientLookup(pRCAP->pContext);
     if (pRCAP->pContext->pRecordingClient)
         RecordInstallHooks(pRCAP, clientspec);
 }                               /* RecordDeleteClientFromRCAP */
@@ -1796,10 +1926,21 @@ RecordRegisterClients(RecordContextPtr pContext, ClientPtr client,
     pRCAP->clientStarted = clientStarted;
     pRCAP->clientDied = clientDied;
 
+    /* flatten the sets for the recording hooks */
+
+    RecordSetToBits(pRCAP->pRequestMajorOpSet, pRCAP->requestMajorBits);
+    RecordSetToBits(pRCAP->pReplyMajorOpSet, pRCAP->replyMajorBits);
+    RecordSetToBits(pRCAP->pDeviceEventSet, pRCAP->deviceEventBits);
+    RecordSetToBits(pRCAP->pDeliveredEventSet, pRCAP->deliveredEventBits);
+    RecordSetToBits(pRCAP->pErrorSet, pRCAP->errorBits);
+    pRCAP->pRequestMinorBits = RecordMinorOpsToBits(pRCAP->pRequestMinOpInfo);
+    pRCAP->pReplyMinorBits = RecordMinorOpsToBits(pRCAP->pReplyMinOpInfo);
+
     /* link the RCAP onto the context */
 
     pRCAP->pNextRCAP = pContext->pListOfRCAP;
     pContext->pListOfRCAP = pRCAP;
+    RecordInvalidateClientLookup(pContext);
 
     if (pContext->pRecordingClient)     /* context enabled */
         RecordInstallHooks(pRCAP, 0);
@@ -1881,6 +2022,10 @@ ProcRecordCreateContext(ClientPtr client)
     pContext->elemHeaders = 0;
     pContext->bufCategory = 0;
     pContext->numBufBytes = 0;
+    pContext->sizeBuf = REPLY_BUF_SIZE;
+    pContext->replyBuffer = malloc(REPLY_BUF_SIZE);
+    if (!pContext->replyBuffer)
+        goto bailout;
     pContext->pBufClient = NULL;
     pContext->continuedReply = 0;
     pContext->inFlush = 0;
@@ -1898,6 +2043,8 @@ ProcRecordCreateContext(ClientPtr client)
         return BadAlloc;
     }
  bailout:
+    if (pContext)
+        free(pContext->replyBuffer);
     free(pContext);
     return err;
 }                               /* ProcRecordCreateContext */
@@ -2345,6 +2492,7 @@ ProcRecordEnableContext(ClientPtr client)
      */
     IgnoreClient(client);
     pContext->pRecordingClient = client;
+    pContext->numBufBytes = 0;
 
     /* Don't allow the data connection to record itself; unregister it. */
     RecordDeleteClientFromContext(pContext,
@@ -2405,6 +2553,20 @@ RecordDisableContext(RecordContextPtr pContext)
     }
 
     pContext->pRecordingClient = NULL;
+    /* whatever couldn't be flushed above is lost with the recording client,
+     * so the buffer is empty and can shrink without losing anything
+     */
+    pContext->numBufBytes = 0;
+
+    /* don't hang on to a buffer grown for a busy stream */
+    if (pContext->sizeBuf > REPLY_BUF_SIZE) {
+        char *buf = realloc(pContext->replyBuffer, REPLY_BUF_SIZE);
+
+        if (buf) {
+            pContext->replyBuffer = buf;
+            pContext->sizeBuf = REPLY_BUF_SIZE;
+        }
+    }
 
     /* move the newly disabled context to the rear part of ppAllContexts,
      * where all the disabled contexts are
@@ -2478,6 +2640,7 @@ RecordDeleteContext(void *value, XID id)
             ppAllContexts = NULL;
         }
     }
+    free(pContext->replyBuffer);
     free(pContext);
 
     return Success;
@@ -0,0 +1,114 @@
+/*
+ * Copyright © 2026 X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "bench.h"
+
+uint64_t
+bench_now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ull + ts.tv_nsec / 1000;
+}
+
+void
+bench_sync(xcb_connection_t *c)
+{
+    free(xcb_get_input_focus_reply(c, xcb_get_input_focus(c), NULL));
+}
+
+/*
+ * The server is on the other end of a local socket, so the kernel can tell
+ * its pid, and /proc how much CPU time it has had.
+ */
+int64_t
+bench_server_cpu_us(xcb_connection_t *c)
+{
+#ifdef SO_PEERCRED
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    unsigned long utime, stime;
+    char path[64], line[1024], *p;
+    FILE *f;
+    int n;
+
+    if (getsockopt(xcb_get_file_descriptor(c), SOL_SOCKET, SO_PEERCRED,
+                   &cred, &len) < 0 || cred.pid <= 0)
+        return -1;
+
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int) cred.pid);
+    f = fopen(path, "r");
+    if (!f)
+        return -1;
+    p = fgets(line, sizeof(line), f);
+    fclose(f);
+
+    /* the command name may contain anything, skip past it */
+    if (!p || !(p = strrchr(line, ')')))
+        return -1;
+    n = sscanf(p + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+               &utime, &stime);
+    if (n != 2)
+        return -1;
+    return (int64_t) (utime + stime) * 1000000 / sysconf(_SC_CLK_TCK);
+#else
+    return -1;
+#endif
+}
+
+void
+bench_start(xcb_connection_t *c, bench_clock *clock)
+{
+    bench_sync(c);
+    clock->cpu_us = bench_server_cpu_us(c);
+    clock->wall_us = bench_now_us();
+}
+
+void
+bench_stop(xcb_connection_t *c, bench_clock *clock, const char *what,
+           int count)
+{
+    uint64_t wall_us;
+    int64_t cpu_us;
+
+    bench_sync(c);
+    wall_us = bench_now_us() - clock->wall_us;
+    cpu_us = bench_server_cpu_us(c);
+
+    printf("%-36s %7d in %9.1fms, %9.2fus each", what, count,
+           wall_us / 1000.0, (double) wall_us / count);
+    if (cpu_us >= 0 && clock->cpu_us >= 0)
+        printf(", server CPU %9.2fus each\n",
+               (double) (cpu_us - clock->cpu_us) / count);
+    else
+        printf("\n");
+}
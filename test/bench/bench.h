@@ -0,0 +1,58 @@
+/*
+ * Copyright © 2026 X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Helpers shared by the client-side timing programs in this directory.
+ * They run against a server started by simple-xinit through meson's
+ * "benchmark" targets (meson test --benchmark) and print their results.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <xcb/xcb.h>
+
+uint64_t bench_now_us(void);
+
+/* a round trip, so everything sent before has been processed */
+void bench_sync(xcb_connection_t *c);
+
+/* CPU time the server process has used so far, -1 if it can't be told */
+int64_t bench_server_cpu_us(xcb_connection_t *c);
+
+typedef struct {
+    uint64_t wall_us;
+    int64_t cpu_us;
+} bench_clock;
+
+/* waits for the server to catch up, then starts timing */
+void bench_start(xcb_connection_t *c, bench_clock *clock);
+
+/* waits for the server to catch up again and prints the wall and server
+ * time per operation since bench_start
+ */
+void bench_stop(xcb_connection_t *c, bench_clock *clock, const char *what,
+                int count);
+
+#endif /* BENCH_H */
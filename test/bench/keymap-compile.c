@@ -0,0 +1,133 @@
+/*
+ * Copyright © 2026 X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Times keymap compiles the way a keyboard being added triggers them:
+ * XkbGetKeyboardByName with a full set of component names makes the
+ * server build the keymap through xkbcomp, or take it from its compiled
+ * keymap cache.  The first request may have to compile, the ones after it
+ * ask for the very same keymap again.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <xcb/xcb.h>
+#include <xcb/xcbext.h>
+#include <X11/Xproto.h>
+#include <X11/extensions/XKB.h>
+#include <X11/extensions/XKBproto.h>
+
+#include "bench.h"
+
+#define NUM_LOADS       20
+
+static const char *components[] = {
+    "",                         /* keymap, unsupported */
+    "evdev+aliases(qwerty)",
+    "complete",
+    "complete",
+    "pc+us+inet(evdev)",
+    "pc(pc105)",
+};
+
+static void *
+xkb_request(xcb_connection_t *c, uint8_t opcode, void *req, size_t len)
+{
+    xcb_protocol_request_t proto = { .count = 1, .opcode = opcode };
+    struct iovec parts[3];
+    unsigned int seq;
+
+    parts[2].iov_base = req;
+    parts[2].iov_len = len;
+    seq = xcb_send_request(c, 0, parts + 2, &proto);
+    return xcb_wait_for_reply(c, seq, NULL);
+}
+
+static int
+load_keymap(xcb_connection_t *c, uint8_t opcode)
+{
+    unsigned char buf[256];
+    xkbGetKbdByNameReq *req = (xkbGetKbdByNameReq *) buf;
+    unsigned char *str = (unsigned char *) &req[1];
+    void *reply;
+    int ok;
+
+    memset(buf, 0, sizeof(buf));
+    req->xkbReqType = X_kbGetKbdByName;
+    req->deviceSpec = XkbUseCoreKbd;
+    req->want = XkbGBN_AllComponentsMask;
+    for (int i = 0; i < sizeof(components) / sizeof(components[0]); i++) {
+        *str++ = strlen(components[i]);
+        memcpy(str, components[i], strlen(components[i]));
+        str += strlen(components[i]);
+    }
+
+    reply = xkb_request(c, opcode, buf, XkbPaddedSize(str - buf));
+    ok = reply != NULL;
+    free(reply);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_query_extension_reply_t *ext;
+    xkbUseExtensionReq use = {
+        .xkbReqType = X_kbUseExtension,
+        .wantedMajor = XkbMajorVersion,
+        .wantedMinor = XkbMinorVersion,
+    };
+    bench_clock clock;
+    uint8_t opcode;
+
+    if (xcb_connection_has_error(c)) {
+        fprintf(stderr, "cannot connect to the server\n");
+        return 1;
+    }
+    ext = xcb_query_extension_reply(c,
+        xcb_query_extension(c, strlen(XkbName), XkbName), NULL);
+    if (!ext || !ext->present) {
+        printf("no XKEYBOARD extension\n");
+        return 77;
+    }
+    opcode = ext->major_opcode;
+    free(ext);
+    free(xkb_request(c, opcode, &use, sizeof(use)));
+
+    bench_start(c, &clock);
+    if (!load_keymap(c, opcode)) {
+        fprintf(stderr, "GetKbdByName failed\n");
+        return 1;
+    }
+    bench_stop(c, &clock, "GetKbdByName, first", 1);
+
+    bench_start(c, &clock);
+    for (int i = 0; i < NUM_LOADS; i++)
+        load_keymap(c, opcode);
+    bench_stop(c, &clock, "GetKbdByName, same keymap again", NUM_LOADS);
+
+    xcb_disconnect(c);
+    return 0;
+}
@@ -0,0 +1,166 @@
+/*
+ * Copyright © 2026 X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Records a client sending a steady stream of small requests and reports
+ * what recording adds to each of them, and how fast the recorded protocol
+ * reaches the recording client.
+ *
+ * The recording client runs in a child process, which creates a context
+ * for all core requests of all clients, enables it and counts what comes
+ * in until the parent disables the context again.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <xcb/xcb.h>
+#include <xcb/record.h>
+
+#include "bench.h"
+
+#define NUM_REQUESTS    100000
+
+/* categories of RecordEnableContext replies */
+#define START_OF_DATA   4
+#define END_OF_DATA     5
+
+static void
+record(int fd)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_record_client_spec_t spec = XCB_RECORD_CS_ALL_CLIENTS;
+    xcb_record_range_t range;
+    xcb_record_context_t context;
+    xcb_record_enable_context_cookie_t cookie;
+    xcb_record_enable_context_reply_t *reply;
+    uint64_t bytes = 0;
+
+    if (xcb_connection_has_error(c))
+        exit(1);
+
+    memset(&range, 0, sizeof(range));
+    range.core_requests.first = 1;
+    range.core_requests.last = 127;
+
+    context = xcb_generate_id(c);
+    xcb_record_create_context(c, context, 0, 1, 1, &spec, &range);
+    cookie = xcb_record_enable_context(c, context);
+    xcb_flush(c);
+
+    while ((reply = xcb_record_enable_context_reply(c, cookie, NULL))) {
+        uint8_t category = reply->category;
+
+        bytes += xcb_record_enable_context_data_length(reply);
+        free(reply);
+        if (category == START_OF_DATA &&
+            write(fd, &context, sizeof(context)) != sizeof(context))
+            exit(1);
+        if (category == END_OF_DATA)
+            break;
+    }
+
+    if (write(fd, &bytes, sizeof(bytes)) != sizeof(bytes))
+        exit(1);
+    xcb_disconnect(c);
+    exit(0);
+}
+
+static void
+change_properties(xcb_connection_t *c, xcb_window_t window, const char *what)
+{
+    bench_clock clock;
+
+    bench_start(c, &clock);
+    for (int i = 0; i < NUM_REQUESTS; i++)
+        xcb_change_property(c, XCB_PROP_MODE_REPLACE, window,
+                            XCB_ATOM_WM_NAME, XCB_ATOM_INTEGER, 32, 1, &i);
+    bench_stop(c, &clock, what, NUM_REQUESTS);
+}
+
+int main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    const xcb_query_extension_reply_t *ext;
+    xcb_record_context_t context;
+    xcb_screen_t *screen;
+    xcb_window_t window;
+    uint64_t start, bytes;
+    int fds[2], status;
+    pid_t pid;
+
+    if (xcb_connection_has_error(c)) {
+        fprintf(stderr, "cannot connect to the server\n");
+        return 1;
+    }
+    ext = xcb_get_extension_data(c, &xcb_record_id);
+    if (!ext || !ext->present) {
+        printf("no RECORD extension\n");
+        return 77;
+    }
+
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    window = xcb_generate_id(c);
+    xcb_create_window(c, XCB_COPY_FROM_PARENT, window, screen->root,
+                      0, 0, 1, 1, 0, XCB_WINDOW_CLASS_INPUT_ONLY,
+                      XCB_COPY_FROM_PARENT, 0, NULL);
+
+    change_properties(c, window, "ChangeProperty, not recorded");
+
+    if (pipe(fds) < 0) {
+        perror("pipe");
+        return 1;
+    }
+    pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return 1;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        record(fds[1]);
+    }
+    close(fds[1]);
+    if (read(fds[0], &context, sizeof(context)) != sizeof(context)) {
+        fprintf(stderr, "recording client failed to start\n");
+        return 1;
+    }
+
+    start = bench_now_us();
+    change_properties(c, window, "ChangeProperty, recorded");
+    xcb_record_disable_context(c, context);
+    xcb_flush(c);
+
+    if (read(fds[0], &bytes, sizeof(bytes)) != sizeof(bytes)) {
+        fprintf(stderr, "recording client failed\n");
+        return 1;
+    }
+    printf("recording client got %.1fMB, %.1fMB/s\n", bytes / 1e6,
+           bytes / (double) (bench_now_us() - start));
+
+    waitpid(pid, &status, 0);
+    xcb_disconnect(c);
+    return 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright © 2026 X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Reports what the server spends on screen updates: nothing at all for a
+ * second, then small and large fills of the root window with a round trip
+ * after each, so that every one of them ends a dispatch cycle the way an
+ * interactive client's drawing does.  Which server options are in effect
+ * is up to whoever starts the server.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <xcb/xcb.h>
+
+#include "bench.h"
+
+#define NUM_SMALL       5000
+#define NUM_LARGE       500
+#define SMALL_SIZE      8
+#define LARGE_SIZE      512
+
+static void
+fill(xcb_connection_t *c, xcb_screen_t *screen, xcb_gcontext_t gc, int count,
+     int size, const char *what)
+{
+    bench_clock clock;
+
+    bench_start(c, &clock);
+    for (int i = 0; i < count; i++) {
+        uint32_t pixel = i & 1 ? screen->white_pixel : screen->black_pixel;
+        xcb_rectangle_t rect = {
+            (i * 37) % (screen->width_in_pixels - size),
+            (i * 17) % (screen->height_in_pixels - size),
+            size, size
+        };
+
+        xcb_change_gc(c, gc, XCB_GC_FOREGROUND, &pixel);
+        xcb_poly_fill_rectangle(c, screen->root, gc, 1, &rect);
+        bench_sync(c);
+    }
+    bench_stop(c, &clock, what, count);
+}
+
+int main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_screen_t *screen;
+    xcb_gcontext_t gc;
+    bench_clock clock;
+
+    if (xcb_connection_has_error(c)) {
+        fprintf(stderr, "cannot connect to the server\n");
+        return 1;
+    }
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    if (screen->width_in_pixels <= LARGE_SIZE ||
+        screen->height_in_pixels <= LARGE_SIZE) {
+        printf("screen too small\n");
+        return 77;
+    }
+
+    gc = xcb_generate_id(c);
+    xcb_create_gc(c, gc, screen->root, 0, NULL);
+
+    bench_start(c, &clock);
+    sleep(1);
+    bench_stop(c, &clock, "idle second", 1);
+
+    fill(c, screen, gc, NUM_SMALL, SMALL_SIZE, "8x8 fill, round trip");
+    fill(c, screen, gc, NUM_LARGE, LARGE_SIZE, "512x512 fill, round trip");
+
+    xcb_disconnect(c);
+    return 0;
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright © 2026 X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Captures a 4K root window with ShmGetImage, the way screen capture
+ * tools and VNC servers do at every frame, and a window that is half
+ * covered by another one, which only has its visible part read.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <xcb/xcb.h>
+#include <xcb/shm.h>
+
+#include "bench.h"
+
+#define NUM_CAPTURES    60
+
+static void
+capture(xcb_connection_t *c, xcb_drawable_t drawable, int width, int height,
+        xcb_shm_seg_t seg, const char *what)
+{
+    bench_clock clock;
+
+    bench_start(c, &clock);
+    for (int i = 0; i < NUM_CAPTURES; i++)
+        free(xcb_shm_get_image_reply(c,
+            xcb_shm_get_image(c, drawable, 0, 0, width, height, ~0,
+                              XCB_IMAGE_FORMAT_Z_PIXMAP, seg, 0), NULL));
+    bench_stop(c, &clock, what, NUM_CAPTURES);
+}
+
+int main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    const xcb_query_extension_reply_t *ext;
+    xcb_screen_t *screen;
+    xcb_window_t window, cover;
+    xcb_shm_seg_t seg;
+    size_t size;
+    int shmid;
+
+    if (xcb_connection_has_error(c)) {
+        fprintf(stderr, "cannot connect to the server\n");
+        return 1;
+    }
+    ext = xcb_get_extension_data(c, &xcb_shm_id);
+    if (!ext || !ext->present) {
+        printf("no MIT-SHM extension\n");
+        return 77;
+    }
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+
+    size = (size_t) screen->width_in_pixels * screen->height_in_pixels * 4;
+    shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+    if (shmid < 0) {
+        perror("shmget");
+        return 77;
+    }
+    seg = xcb_generate_id(c);
+    xcb_shm_attach(c, seg, shmid, 0);
+    bench_sync(c);
+    /* the server has it attached now, so it goes away with the last user */
+    shmctl(shmid, IPC_RMID, NULL);
+
+    capture(c, screen->root, screen->width_in_pixels,
+            screen->height_in_pixels, seg, "ShmGetImage, root");
+
+    window = xcb_generate_id(c);
+    xcb_create_window(c, XCB_COPY_FROM_PARENT, window, screen->root,
+                      0, 0, screen->width_in_pixels, screen->height_in_pixels,
+                      0, XCB_WINDOW_CLASS_INPUT_OUTPUT, screen->root_visual,
+                      0, NULL);
+    cover = xcb_generate_id(c);
+    xcb_create_window(c, XCB_COPY_FROM_PARENT, cover, screen->root,
+                      0, screen->height_in_pixels / 2,
+                      screen->width_in_pixels, screen->height_in_pixels / 2,
+                      0, XCB_WINDOW_CLASS_INPUT_OUTPUT, screen->root_visual,
+                      0, NULL);
+    xcb_map_window(c, window);
+    xcb_map_window(c, cover);
+
+    capture(c, window, screen->width_in_pixels, screen->height_in_pixels,
+            seg, "ShmGetImage, window half covered");
+
+    xcb_shm_detach(c, seg);
+    xcb_disconnect(c);
+    return 0;
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright © 2026 X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Puts 10000 alarms on a single counter and reports what each
+ * ChangeCounter costs: with no alarms at all, with alarms none of the
+ * changes can fire, and with one alarm firing per change.  Creating the
+ * alarms is timed too.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <xcb/xcb.h>
+#include <xcb/sync.h>
+
+#include "bench.h"
+
+#define NUM_ALARMS      10000
+#define NUM_CHANGES     10000
+
+static xcb_sync_counter_t
+create_counter(xcb_connection_t *c)
+{
+    xcb_sync_counter_t counter = xcb_generate_id(c);
+    xcb_sync_int64_t zero = { 0, 0 };
+
+    xcb_sync_create_counter(c, counter, zero);
+    return counter;
+}
+
+/* positive comparison alarms at first, first + 1, ... */
+static void
+create_alarms(xcb_connection_t *c, xcb_sync_counter_t counter,
+              uint32_t first, const char *what)
+{
+    uint32_t mask = XCB_SYNC_CA_COUNTER | XCB_SYNC_CA_VALUE |
+                    XCB_SYNC_CA_TEST_TYPE | XCB_SYNC_CA_DELTA |
+                    XCB_SYNC_CA_EVENTS;
+    bench_clock clock;
+
+    bench_start(c, &clock);
+    for (int i = 0; i < NUM_ALARMS; i++) {
+        uint32_t values[] = {
+            counter, 0, first + i, XCB_SYNC_TESTTYPE_POSITIVE_COMPARISON,
+            0, 0, 0
+        };
+
+        xcb_sync_create_alarm(c, xcb_generate_id(c), mask, values);
+    }
+    bench_stop(c, &clock, what, NUM_ALARMS);
+}
+
+static void
+change_counter(xcb_connection_t *c, xcb_sync_counter_t counter,
+               const char *what)
+{
+    xcb_sync_int64_t one = { 0, 1 };
+    bench_clock clock;
+
+    bench_start(c, &clock);
+    for (int i = 0; i < NUM_CHANGES; i++)
+        xcb_sync_change_counter(c, counter, one);
+    bench_stop(c, &clock, what, NUM_CHANGES);
+}
+
+int main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_sync_counter_t bare, idle, firing;
+
+    if (xcb_connection_has_error(c)) {
+        fprintf(stderr, "cannot connect to the server\n");
+        return 1;
+    }
+
+    bare = create_counter(c);
+    change_counter(c, bare, "ChangeCounter, no alarms");
+
+    idle = create_counter(c);
+    create_alarms(c, idle, 1 << 30, "CreateAlarm, 10000 on one counter");
+    change_counter(c, idle, "ChangeCounter, 10000 alarms idle");
+
+    firing = create_counter(c);
+    create_alarms(c, firing, 1, "CreateAlarm, 10000 on one counter");
+    change_counter(c, firing, "ChangeCounter, 10000 alarms firing");
+
+    xcb_disconnect(c);
+    return 0;
+}
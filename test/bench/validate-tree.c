@@ -0,0 +1,116 @@
+/*
+ * Copyright © 2026 X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Drags a window across a toplevel with 2000 children and reports what
+ * each move costs, mostly clip computation in ValidateTree.  Run once as
+ * is and once with every toplevel redirected by Composite, the way a
+ * compositing manager sets things up.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <xcb/xcb.h>
+#include <xcb/composite.h>
+
+#include "bench.h"
+
+#define TREE_WIDTH      800
+#define TREE_HEIGHT     600
+#define CHILD_COLUMNS   50
+#define CHILD_ROWS      40
+#define NUM_MOVES       2000
+
+static xcb_window_t
+create_window(xcb_connection_t *c, xcb_screen_t *screen, xcb_window_t parent,
+              int x, int y, int width, int height)
+{
+    uint32_t values[] = { screen->white_pixel };
+    xcb_window_t window = xcb_generate_id(c);
+
+    xcb_create_window(c, XCB_COPY_FROM_PARENT, window, parent,
+                      x, y, width, height, 1, XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                      screen->root_visual, XCB_CW_BACK_PIXEL, values);
+    return window;
+}
+
+static void
+drag(xcb_connection_t *c, xcb_window_t window, const char *what)
+{
+    bench_clock clock;
+
+    bench_start(c, &clock);
+    for (int i = 0; i < NUM_MOVES; i++) {
+        uint32_t pos[] = {
+            (i * 7) % (TREE_WIDTH - 100),
+            (i * 3) % (TREE_HEIGHT - 100),
+        };
+
+        xcb_configure_window(c, window,
+                             XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y, pos);
+    }
+    bench_stop(c, &clock, what, NUM_MOVES);
+}
+
+int main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    const xcb_query_extension_reply_t *ext;
+    xcb_screen_t *screen;
+    xcb_window_t tree, mover;
+
+    if (xcb_connection_has_error(c)) {
+        fprintf(stderr, "cannot connect to the server\n");
+        return 1;
+    }
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+
+    tree = create_window(c, screen, screen->root, 0, 0,
+                         TREE_WIDTH, TREE_HEIGHT);
+    for (int i = 0; i < CHILD_COLUMNS * CHILD_ROWS; i++)
+        create_window(c, screen, tree,
+                      (i % CHILD_COLUMNS) * (TREE_WIDTH / CHILD_COLUMNS),
+                      (i / CHILD_COLUMNS) * (TREE_HEIGHT / CHILD_ROWS),
+                      TREE_WIDTH / CHILD_COLUMNS - 2,
+                      TREE_HEIGHT / CHILD_ROWS - 2);
+    xcb_map_subwindows(c, tree);
+    xcb_map_window(c, tree);
+
+    mover = create_window(c, screen, screen->root, 0, 0, 100, 100);
+    xcb_map_window(c, mover);
+
+    drag(c, mover, "move over 2000 children");
+
+    ext = xcb_get_extension_data(c, &xcb_composite_id);
+    if (ext && ext->present) {
+        free(xcb_composite_query_version_reply(c,
+            xcb_composite_query_version(c, XCB_COMPOSITE_MAJOR_VERSION,
+                                        XCB_COMPOSITE_MINOR_VERSION), NULL));
+        xcb_composite_redirect_subwindows(c, screen->root,
+                                          XCB_COMPOSITE_REDIRECT_AUTOMATIC);
+        drag(c, mover, "move over 2000 children, redirected");
+    }
+
+    xcb_disconnect(c);
+    return 0;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright © 2026 X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Replays a recorded-session-like stream of synthetic input through XTest
+ * FakeInput, one event per request the way replay tools send them, and
+ * reports the cost per event.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <xcb/xcb.h>
+#include <xcb/xtest.h>
+
+#include "bench.h"
+
+#define NUM_MOTIONS     20000
+#define NUM_KEYS        5000
+
+int main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    const xcb_query_extension_reply_t *ext;
+    xcb_screen_t *screen;
+    bench_clock clock;
+    xcb_keycode_t keycode;
+
+    if (xcb_connection_has_error(c)) {
+        fprintf(stderr, "cannot connect to the server\n");
+        return 1;
+    }
+    ext = xcb_get_extension_data(c, &xcb_test_id);
+    if (!ext || !ext->present) {
+        printf("no XTEST extension\n");
+        return 77;
+    }
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    keycode = xcb_get_setup(c)->min_keycode;
+
+    bench_start(c, &clock);
+    for (int i = 0; i < NUM_MOTIONS; i++)
+        xcb_test_fake_input(c, XCB_MOTION_NOTIFY, 0, XCB_CURRENT_TIME,
+                            screen->root,
+                            i % screen->width_in_pixels,
+                            (i / 7) % screen->height_in_pixels, 0);
+    bench_stop(c, &clock, "FakeInput motion", NUM_MOTIONS);
+
+    bench_start(c, &clock);
+    for (int i = 0; i < NUM_KEYS; i++) {
+        xcb_test_fake_input(c, XCB_KEY_PRESS, keycode, XCB_CURRENT_TIME,
+                            XCB_NONE, 0, 0, 0);
+        xcb_test_fake_input(c, XCB_KEY_RELEASE, keycode, XCB_CURRENT_TIME,
+                            XCB_NONE, 0, 0, 0);
+    }
+    bench_stop(c, &clock, "FakeInput key press and release", 2 * NUM_KEYS);
+
+    xcb_disconnect(c);
+    return 0;
+}
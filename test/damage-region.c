@@ -0,0 +1,165 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Tests for the damage region coarsening policy.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <dix-config.h>
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "miext/damage/damage_priv.h"
+
+#include "regionstr.h"
+#include "tests-common.h"
+
+/* A checkerboard of 1x1 boxes which can't be merged by the region code. */
+static void
+make_checkerboard(RegionPtr pRegion, BoxPtr boxes, int *nboxes,
+                  int x, int y, int w, int h)
+{
+    int n = 0;
+
+    RegionNull(pRegion);
+    for (int j = 0; j < h; j++) {
+        for (int i = (j & 1); i < w; i += 2) {
+            BoxRec box = { x + i, y + j, x + i + 1, y + j + 1 };
+            RegionRec tmp;
+
+            RegionInit(&tmp, &box, 1);
+            RegionUnion(pRegion, pRegion, &tmp);
+            RegionUninit(&tmp);
+            boxes[n++] = box;
+        }
+    }
+    *nboxes = n;
+}
+
+static void
+check_covers(RegionPtr pRegion, BoxPtr boxes, int nboxes, BoxPtr extents)
+{
+    BoxPtr e = RegionExtents(pRegion);
+
+    for (int i = 0; i < nboxes; i++)
+        assert(RegionContainsRect(pRegion, &boxes[i]) == rgnIN);
+
+    assert(e->x1 == extents->x1 && e->y1 == extents->y1 &&
+           e->x2 == extents->x2 && e->y2 == extents->y2);
+}
+
+static void
+damage_coarsen_below_limit(void)
+{
+    BoxRec boxes[16 * 16];
+    RegionRec region;
+    int nboxes, nrects;
+
+    make_checkerboard(&region, boxes, &nboxes, 0, 0, 16, 16);
+    nrects = RegionNumRects(&region);
+
+    assert(!damageCoarsenRegion(&region, nrects, 8));
+    assert(RegionNumRects(&region) == nrects);
+    assert(!damageCoarsenRegion(&region, 0, 8));
+    assert(RegionNumRects(&region) == nrects);
+
+    RegionUninit(&region);
+}
+
+static void
+damage_coarsen_tiles(void)
+{
+    BoxRec boxes[64 * 64];
+    BoxRec extents;
+    RegionRec region;
+    int nboxes;
+
+    /* Unaligned origin to exercise tile alignment against extents */
+    make_checkerboard(&region, boxes, &nboxes, 13, 7, 61, 37);
+    extents = *RegionExtents(&region);
+
+    assert(damageCoarsenRegion(&region, 64, 16));
+    assert(RegionNumRects(&region) <= 64);
+    check_covers(&region, boxes, nboxes, &extents);
+
+    RegionUninit(&region);
+}
+
+static void
+damage_coarsen_sparse_tiles(void)
+{
+    BoxRec boxes[2 * 8 * 8];
+    BoxRec extents;
+    RegionRec region, other;
+    int nboxes, nother;
+
+    /* Two clusters far apart: the tile covering must keep the gap empty */
+    make_checkerboard(&region, boxes, &nboxes, 0, 0, 8, 8);
+    make_checkerboard(&other, boxes + nboxes, &nother, 200, 200, 8, 8);
+    RegionUnion(&region, &region, &other);
+    RegionUninit(&other);
+    nboxes += nother;
+    extents = *RegionExtents(&region);
+
+    assert(damageCoarsenRegion(&region, 4, 8));
+    assert(RegionNumRects(&region) == 2);
+    check_covers(&region, boxes, nboxes, &extents);
+
+    BoxRec gap = { 100, 100, 101, 101 };
+    assert(RegionContainsRect(&region, &gap) == rgnOUT);
+
+    RegionUninit(&region);
+}
+
+static void
+damage_coarsen_extents_fallback(void)
+{
+    BoxRec boxes[16 * 16];
+    BoxRec extents;
+    RegionRec region;
+    int nboxes = 0;
+
+    /* Isolated dots every 4 pixels stay fragmented with tiles of 2 */
+    RegionNull(&region);
+    for (int y = 0; y < 64; y += 4) {
+        for (int x = 0; x < 64; x += 4) {
+            BoxRec box = { x, y, x + 1, y + 1 };
+            RegionRec tmp;
+
+            RegionInit(&tmp, &box, 1);
+            RegionUnion(&region, &region, &tmp);
+            RegionUninit(&tmp);
+            boxes[nboxes++] = box;
+        }
+    }
+    extents = *RegionExtents(&region);
+
+    assert(damageCoarsenRegion(&region, 4, 2));
+    assert(RegionNumRects(&region) == 1);
+    check_covers(&region, boxes, nboxes, &extents);
+    RegionUninit(&region);
+
+    /* tileSize <= 1 goes straight to the extents */
+    make_checkerboard(&region, boxes, &nboxes, 0, 0, 16, 16);
+    extents = *RegionExtents(&region);
+    assert(damageCoarsenRegion(&region, 4, 0));
+    assert(RegionNumRects(&region) == 1);
+    check_covers(&region, boxes, nboxes, &extents);
+    RegionUninit(&region);
+}
+
+const testfunc_t*
+damage_region_test(void)
+{
+    static const testfunc_t testfuncs[] = {
+        damage_coarsen_below_limit,
+        damage_coarsen_tiles,
+        damage_coarsen_sparse_tiles,
+        damage_coarsen_extents_fallback,
+        NULL,
+    };
+
+    return testfuncs;
+}
@@ -0,0 +1,246 @@
+/*
+ * Copyright © 2026 X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * A ListFonts that walks a long font path must not hold off other clients
+ * until it is done: the server lists fonts in time slices and dispatches
+ * other clients in between.
+ *
+ * The font path names one directory with a long fonts.dir many times over,
+ * and the pattern matches nothing, so every name is looked at for every
+ * element.  The listing client changes a root window property right before
+ * and right after its ListFonts; a second client changes one as soon as it
+ * hears about the first.  Each change shows up as a PropertyNotify, in the
+ * order the server carried them out, so the second client's change has to
+ * come before the listing client's closing one.
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <xcb/xcb.h>
+
+#define NUM_ELEMENTS    128
+#define NAMES_PER_DIR   4000
+
+/* the listing has to take a few slices for the result to mean anything */
+#define MIN_LIST_MS     60
+
+static char fontdir[PATH_MAX];
+
+static double
+now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static void
+make_font_dir(void)
+{
+    char name[PATH_MAX + 16];
+    FILE *f;
+
+    if (!getcwd(fontdir, sizeof(fontdir) - 32)) {
+        perror("getcwd");
+        exit(1);
+    }
+    strcat(fontdir, "/list-slicing-XXXXXX");
+    if (!mkdtemp(fontdir)) {
+        perror("mkdtemp");
+        exit(1);
+    }
+
+    /* the font files don't need to exist for their names to be listed */
+    snprintf(name, sizeof(name), "%s/fonts.dir", fontdir);
+    f = fopen(name, "w");
+    if (!f) {
+        perror(name);
+        exit(1);
+    }
+    fprintf(f, "%d\n", NAMES_PER_DIR);
+    for (int i = 0; i < NAMES_PER_DIR; i++)
+        fprintf(f, "f%05d.pcf -slice-f%05d-medium-r-normal--10-100-75-75-c-60-iso8859-1\n",
+                i, i);
+    fclose(f);
+}
+
+static void
+cleanup(void)
+{
+    char name[PATH_MAX + 16];
+
+    snprintf(name, sizeof(name), "%s/fonts.dir", fontdir);
+    unlink(name);
+    rmdir(fontdir);
+}
+
+static void
+set_font_path(xcb_connection_t *c)
+{
+    size_t len = strlen(fontdir);
+    xcb_generic_error_t *error;
+    char *path, *p;
+
+    path = malloc(NUM_ELEMENTS * (1 + len));
+    if (!path)
+        exit(1);
+
+    /* the same directory over and over again is still a long font path */
+    p = path;
+    for (int i = 0; i < NUM_ELEMENTS; i++) {
+        *p++ = len;
+        memcpy(p, fontdir, len);
+        p += len;
+    }
+
+    error = xcb_request_check(c, xcb_set_font_path_checked(c, NUM_ELEMENTS,
+                                                           (xcb_str_t *) path));
+    free(path);
+    if (error) {
+        fprintf(stderr, "SetFontPath failed, error %d\n", error->error_code);
+        exit(1);
+    }
+}
+
+static xcb_atom_t
+intern(xcb_connection_t *c, const char *name)
+{
+    xcb_intern_atom_reply_t *reply;
+    xcb_atom_t atom;
+
+    reply = xcb_intern_atom_reply(c, xcb_intern_atom(c, 0, strlen(name), name),
+                                  NULL);
+    if (!reply) {
+        fprintf(stderr, "InternAtom %s failed\n", name);
+        exit(1);
+    }
+    atom = reply->atom;
+    free(reply);
+    return atom;
+}
+
+static void
+touch_property(xcb_connection_t *c, xcb_window_t root, xcb_atom_t atom)
+{
+    xcb_change_property(c, XCB_PROP_MODE_REPLACE, root, atom,
+                        XCB_ATOM_INTEGER, 32, 0, NULL);
+}
+
+/* returns the next PropertyNotify on one of the test's own atoms */
+static xcb_atom_t
+wait_for_property(xcb_connection_t *c, xcb_atom_t first, xcb_atom_t last)
+{
+    xcb_generic_event_t *ev;
+
+    while ((ev = xcb_wait_for_event(c))) {
+        if ((ev->response_type & 0x7f) == XCB_PROPERTY_NOTIFY) {
+            xcb_atom_t atom = ((xcb_property_notify_event_t *) ev)->atom;
+
+            if (atom >= first && atom <= last) {
+                free(ev);
+                return atom;
+            }
+        }
+        free(ev);
+    }
+    fprintf(stderr, "connection lost\n");
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    static const char pattern[] = "*-nomatch";
+    xcb_connection_t *lister = xcb_connect(NULL, NULL);
+    xcb_connection_t *other = xcb_connect(NULL, NULL);
+    uint32_t mask = XCB_EVENT_MASK_PROPERTY_CHANGE;
+    xcb_atom_t start_atom, mark_atom, done_atom, first, last, atom;
+    xcb_list_fonts_cookie_t list;
+    xcb_window_t root;
+    double start, elapsed;
+    int served;
+
+    if (xcb_connection_has_error(lister) || xcb_connection_has_error(other)) {
+        fprintf(stderr, "cannot connect to the server\n");
+        return 1;
+    }
+    root = xcb_setup_roots_iterator(xcb_get_setup(other)).data->root;
+
+    make_font_dir();
+    atexit(cleanup);
+    set_font_path(lister);
+
+    start_atom = intern(other, "LIST_SLICING_START");
+    mark_atom = intern(other, "LIST_SLICING_MARK");
+    done_atom = intern(other, "LIST_SLICING_DONE");
+    first = start_atom < mark_atom ? start_atom : mark_atom;
+    first = first < done_atom ? first : done_atom;
+    last = start_atom > mark_atom ? start_atom : mark_atom;
+    last = last > done_atom ? last : done_atom;
+
+    xcb_change_window_attributes(other, root, XCB_CW_EVENT_MASK, &mask);
+    free(xcb_get_input_focus_reply(other, xcb_get_input_focus(other), NULL));
+
+    /* all three go out in one write, so nothing but the server's own
+     * scheduling can let another client in between them
+     */
+    start = now_ms();
+    touch_property(lister, root, start_atom);
+    list = xcb_list_fonts(lister, 0xffff, strlen(pattern), pattern);
+    touch_property(lister, root, done_atom);
+    xcb_flush(lister);
+
+    atom = wait_for_property(other, first, last);
+    if (atom != start_atom) {
+        fprintf(stderr, "unexpected PropertyNotify for atom %u\n", atom);
+        return 1;
+    }
+    touch_property(other, root, mark_atom);
+    xcb_flush(other);
+
+    atom = wait_for_property(other, first, last);
+    served = atom == mark_atom;
+
+    free(xcb_list_fonts_reply(lister, list, NULL));
+    elapsed = now_ms() - start;
+
+    xcb_disconnect(other);
+    xcb_disconnect(lister);
+
+    if (served) {
+        printf("other client served during a %.1fms listing\n", elapsed);
+        return 0;
+    }
+    if (elapsed < MIN_LIST_MS) {
+        printf("listing took only %.1fms, too fast to tell\n", elapsed);
+        return 77;
+    }
+    fprintf(stderr, "other client waited for a %.1fms listing\n", elapsed);
+    return 1;
+}
@@ -0,0 +1,191 @@
+/*
+ * Copyright © 2026 X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Screens without a CRTC run a fake vblank clock.  Asks for a few hundred
+ * consecutive frames with PresentNotifyMSC, one at a time like a client
+ * pacing itself on completion events, and checks what comes back:
+ *
+ *  - every frame's UST is its MSC times the refresh interval, so the
+ *    spacing of consecutive frames doesn't jitter at all;
+ *  - MSCs never go backwards and no frame is completed before its target;
+ *  - no completion reaches the client before the UST it reports (the
+ *    server and this client both go by CLOCK_MONOTONIC).
+ *
+ * Run with -fakescreenfps set high enough to keep the test short.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <xcb/xcb.h>
+#include <xcb/present.h>
+
+#define NUM_FRAMES      400
+
+/* tolerate a loaded machine missing the odd tick */
+#define MAX_MISSED      (NUM_FRAMES / 10)
+
+static uint64_t
+now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ull + ts.tv_nsec / 1000;
+}
+
+static xcb_present_complete_notify_event_t *
+wait_for_complete(xcb_connection_t *c, uint8_t present_opcode)
+{
+    xcb_generic_event_t *ev;
+
+    while ((ev = xcb_wait_for_event(c))) {
+        xcb_ge_generic_event_t *ge = (xcb_ge_generic_event_t *) ev;
+
+        if ((ev->response_type & 0x7f) == XCB_GE_GENERIC &&
+            ge->extension == present_opcode &&
+            ge->event_type == XCB_PRESENT_EVENT_COMPLETE_NOTIFY)
+            return (xcb_present_complete_notify_event_t *) ev;
+        if (ev->response_type == 0) {
+            fprintf(stderr, "X error %d\n",
+                    ((xcb_generic_error_t *) ev)->error_code);
+            exit(1);
+        }
+        free(ev);
+    }
+    fprintf(stderr, "connection lost\n");
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    const xcb_query_extension_reply_t *ext;
+    xcb_present_query_version_reply_t *version;
+    xcb_screen_t *screen;
+    xcb_window_t window;
+    uint64_t interval = 0, target = 0, prev_ust = 0, prev_msc = 0;
+    uint64_t worst_latency = 0, total_latency = 0;
+    int missed = 0, failed = 0;
+
+    if (xcb_connection_has_error(c)) {
+        fprintf(stderr, "cannot connect to the server\n");
+        return 1;
+    }
+    ext = xcb_get_extension_data(c, &xcb_present_id);
+    if (!ext || !ext->present) {
+        printf("no Present extension\n");
+        return 77;
+    }
+    version = xcb_present_query_version_reply(c,
+        xcb_present_query_version(c, XCB_PRESENT_MAJOR_VERSION,
+                                  XCB_PRESENT_MINOR_VERSION), NULL);
+    free(version);
+
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    window = xcb_generate_id(c);
+    xcb_create_window(c, XCB_COPY_FROM_PARENT, window, screen->root,
+                      0, 0, 64, 64, 0, XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                      screen->root_visual, 0, NULL);
+    xcb_map_window(c, window);
+    xcb_present_select_input(c, xcb_generate_id(c), window,
+                             XCB_PRESENT_EVENT_MASK_COMPLETE_NOTIFY);
+
+    for (int i = 0; i <= NUM_FRAMES; i++) {
+        xcb_present_complete_notify_event_t *ev;
+        uint64_t received;
+
+        /* target 0 completes right away and tells us where the clock is */
+        xcb_present_notify_msc(c, window, i, target, 0, 0);
+        xcb_flush(c);
+        ev = wait_for_complete(c, ext->major_opcode);
+        received = now_us();
+
+        if (ev->serial != i) {
+            fprintf(stderr, "frame %d: completion for serial %u\n",
+                    i, ev->serial);
+            return 1;
+        }
+        if (i == 0) {
+            if (ev->msc == 0 || ev->ust % ev->msc) {
+                fprintf(stderr, "ust %llu is not a whole number of "
+                        "intervals at msc %llu\n",
+                        (unsigned long long) ev->ust,
+                        (unsigned long long) ev->msc);
+                return 1;
+            }
+            interval = ev->ust / ev->msc;
+        }
+        else {
+            uint64_t latency = received - ev->ust;
+
+            if (ev->msc < target) {
+                fprintf(stderr, "frame %d: msc %llu before target %llu\n", i,
+                        (unsigned long long) ev->msc,
+                        (unsigned long long) target);
+                failed = 1;
+            }
+            else if (ev->msc > target)
+                missed++;
+            if (ev->msc <= prev_msc ||
+                ev->ust - prev_ust != (ev->msc - prev_msc) * interval) {
+                fprintf(stderr, "frame %d: ust %llu msc %llu after ust %llu "
+                        "msc %llu, interval %llu\n", i,
+                        (unsigned long long) ev->ust,
+                        (unsigned long long) ev->msc,
+                        (unsigned long long) prev_ust,
+                        (unsigned long long) prev_msc,
+                        (unsigned long long) interval);
+                failed = 1;
+            }
+            if (received < ev->ust) {
+                fprintf(stderr, "frame %d: delivered %lluus before its ust\n",
+                        i, (unsigned long long) (ev->ust - received));
+                failed = 1;
+            }
+            else {
+                total_latency += latency;
+                if (latency > worst_latency)
+                    worst_latency = latency;
+            }
+        }
+
+        prev_ust = ev->ust;
+        prev_msc = ev->msc;
+        target = ev->msc + 1;
+        free(ev);
+    }
+
+    xcb_disconnect(c);
+
+    printf("%d frames at %lluus, %d missed, latency mean %lluus max %lluus\n",
+           NUM_FRAMES, (unsigned long long) interval, missed,
+           (unsigned long long) (total_latency / NUM_FRAMES),
+           (unsigned long long) worst_latency);
+    if (missed > MAX_MISSED) {
+        fprintf(stderr, "missed more than %d frames\n", MAX_MISSED);
+        failed = 1;
+    }
+    return failed;
+}
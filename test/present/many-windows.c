@@ -0,0 +1,173 @@
+/*
+ * Copyright © 2026 X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Many windows waiting on the same vblanks.  Each of NUM_WINDOWS windows
+ * asks for the next frame with PresentNotifyMSC, every frame for a second
+ * of 60Hz, and every window has to hear back about every frame, never
+ * before the MSC it asked for.  In the last frame every other window is
+ * destroyed while its request is pending, which must abort just those.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xcb/xcb.h>
+#include <xcb/present.h>
+
+#define NUM_WINDOWS     200
+#define NUM_FRAMES      60
+
+static xcb_present_complete_notify_event_t *
+wait_for_complete(xcb_connection_t *c, uint8_t present_opcode)
+{
+    xcb_generic_event_t *ev;
+
+    while ((ev = xcb_wait_for_event(c))) {
+        xcb_ge_generic_event_t *ge = (xcb_ge_generic_event_t *) ev;
+
+        if ((ev->response_type & 0x7f) == XCB_GE_GENERIC &&
+            ge->extension == present_opcode &&
+            ge->event_type == XCB_PRESENT_EVENT_COMPLETE_NOTIFY)
+            return (xcb_present_complete_notify_event_t *) ev;
+        if (ev->response_type == 0) {
+            fprintf(stderr, "X error %d\n",
+                    ((xcb_generic_error_t *) ev)->error_code);
+            exit(1);
+        }
+        free(ev);
+    }
+    fprintf(stderr, "connection lost\n");
+    exit(1);
+}
+
+static int
+window_index(const xcb_window_t *windows, xcb_window_t window)
+{
+    for (int i = 0; i < NUM_WINDOWS; i++)
+        if (windows[i] == window)
+            return i;
+    return -1;
+}
+
+int main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    const xcb_query_extension_reply_t *ext;
+    xcb_screen_t *screen;
+    xcb_window_t windows[NUM_WINDOWS];
+    xcb_present_complete_notify_event_t *ev;
+    uint64_t target;
+
+    if (xcb_connection_has_error(c)) {
+        fprintf(stderr, "cannot connect to the server\n");
+        return 1;
+    }
+    ext = xcb_get_extension_data(c, &xcb_present_id);
+    if (!ext || !ext->present) {
+        printf("no Present extension\n");
+        return 77;
+    }
+    free(xcb_present_query_version_reply(c,
+        xcb_present_query_version(c, XCB_PRESENT_MAJOR_VERSION,
+                                  XCB_PRESENT_MINOR_VERSION), NULL));
+
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    for (int i = 0; i < NUM_WINDOWS; i++) {
+        windows[i] = xcb_generate_id(c);
+        xcb_create_window(c, XCB_COPY_FROM_PARENT, windows[i], screen->root,
+                          (i % 20) * 16, (i / 20) * 16, 16, 16, 0,
+                          XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                          screen->root_visual, 0, NULL);
+        xcb_map_window(c, windows[i]);
+        xcb_present_select_input(c, xcb_generate_id(c), windows[i],
+                                 XCB_PRESENT_EVENT_MASK_COMPLETE_NOTIFY);
+    }
+
+    /* target 0 completes right away and tells us where the clock is */
+    xcb_present_notify_msc(c, windows[0], 0, 0, 0, 0);
+    xcb_flush(c);
+    ev = wait_for_complete(c, ext->major_opcode);
+    target = ev->msc + 1;
+    free(ev);
+
+    for (int frame = 1; frame <= NUM_FRAMES; frame++) {
+        char seen[NUM_WINDOWS] = { 0 };
+        int expected = NUM_WINDOWS;
+        uint64_t msc = 0;
+
+        for (int i = 0; i < NUM_WINDOWS; i++)
+            xcb_present_notify_msc(c, windows[i], frame, target, 0, 0);
+        if (frame == NUM_FRAMES) {
+            for (int i = 1; i < NUM_WINDOWS; i += 2) {
+                xcb_destroy_window(c, windows[i]);
+                seen[i] = 1;
+                expected--;
+            }
+        }
+        xcb_flush(c);
+
+        while (expected) {
+            int i;
+
+            ev = wait_for_complete(c, ext->major_opcode);
+            i = window_index(windows, ev->window);
+            if (i < 0 || ev->serial != frame || seen[i]) {
+                fprintf(stderr, "frame %d: unexpected completion for window "
+                        "0x%x serial %u\n", frame, ev->window, ev->serial);
+                return 1;
+            }
+            if (ev->msc < target) {
+                fprintf(stderr, "frame %d: window %d completed at msc %llu, "
+                        "target %llu\n", frame, i,
+                        (unsigned long long) ev->msc,
+                        (unsigned long long) target);
+                return 1;
+            }
+            if (ev->msc > msc)
+                msc = ev->msc;
+            seen[i] = 1;
+            expected--;
+            free(ev);
+        }
+        target = msc + 1;
+    }
+
+    /* nothing more may turn up for the destroyed windows */
+    free(xcb_get_input_focus_reply(c, xcb_get_input_focus(c), NULL));
+    while ((ev = (xcb_present_complete_notify_event_t *)
+            xcb_poll_for_event(c))) {
+        if ((ev->response_type & 0x7f) == XCB_GE_GENERIC &&
+            ev->extension == ext->major_opcode &&
+            ev->event_type == XCB_PRESENT_EVENT_COMPLETE_NOTIFY) {
+            fprintf(stderr, "completion for destroyed window 0x%x\n",
+                    ev->window);
+            return 1;
+        }
+        free(ev);
+    }
+
+    xcb_disconnect(c);
+    printf("%d windows completed %d frames\n", NUM_WINDOWS, NUM_FRAMES);
+    return 0;
+}
@@ -285,6 +285,80 @@ test_change_alarm_delta(xcb_connection_t *c)
     }
 }
 
+static int
+count_alarm_notifies(xcb_connection_t *c, xcb_sync_counter_t counter,
+                     uint8_t first_event)
+{
+    xcb_generic_event_t *ev;
+    int count = 0;
+
+    /* round trip so all events from previous requests have arrived */
+    free(xcb_sync_query_counter_reply(c,
+             xcb_sync_query_counter(c, counter), NULL));
+
+    while ((ev = xcb_poll_for_event(c))) {
+        if ((ev->response_type & 0x7f) == first_event + XCB_SYNC_ALARM_NOTIFY)
+            count++;
+        free(ev);
+    }
+    return count;
+}
+
+/* Move a counter around with a transition and a comparison alarm on it,
+ * and check that each fires exactly when it should, including after
+ * changes that can't fire anything.
+ */
+static void
+test_alarm_fires(xcb_connection_t *c, uint8_t first_event)
+{
+    xcb_sync_counter_t counter = xcb_generate_id(c);
+    xcb_sync_alarm_t transition = xcb_generate_id(c);
+    xcb_sync_alarm_t comparison = xcb_generate_id(c);
+    uint32_t mask = XCB_SYNC_CA_COUNTER | XCB_SYNC_CA_VALUE |
+                    XCB_SYNC_CA_TEST_TYPE | XCB_SYNC_CA_DELTA;
+    uint32_t transition_values[] = {
+        counter, 0, 10, XCB_SYNC_TESTTYPE_POSITIVE_TRANSITION, 0, 0
+    };
+    uint32_t comparison_values[] = {
+        counter, 0, 100, XCB_SYNC_TESTTYPE_POSITIVE_COMPARISON, 0, 10
+    };
+    static const struct {
+        int64_t value;
+        int notifies;
+    } steps[] = {
+        { 5, 0 },
+        { 20, 1 },      /* transition */
+        { 15, 0 },
+        { 5, 0 },
+        { 15, 1 },      /* transition again */
+        { 99, 0 },
+        { 100, 1 },     /* comparison, moves on to 110 */
+        { 105, 0 },
+        { 110, 1 },     /* comparison, moves on to 120 */
+    };
+
+    xcb_sync_create_counter(c, counter, sync_value(0));
+    xcb_sync_create_alarm(c, transition, mask, transition_values);
+    xcb_sync_create_alarm(c, comparison, mask, comparison_values);
+
+    for (int i = 0; i < ARRAY_SIZE(steps); i++) {
+        int notifies;
+
+        xcb_sync_set_counter(c, counter, sync_value(steps[i].value));
+        notifies = count_alarm_notifies(c, counter, first_event);
+        if (notifies != steps[i].notifies) {
+            fprintf(stderr, "Setting counter to %lld sent %d alarm "
+                    "notifies, expected %d\n",
+                    (long long)steps[i].value, notifies, steps[i].notifies);
+            exit(1);
+        }
+    }
+
+    xcb_sync_destroy_alarm(c, transition);
+    xcb_sync_destroy_alarm(c, comparison);
+    xcb_sync_destroy_counter(c, counter);
+}
+
 int main(int argc, char **argv)
 {
     int screen;
@@ -302,6 +376,7 @@ int main(int argc, char **argv)
     test_change_counter_overflow(c);
     test_change_alarm_value(c);
     test_change_alarm_delta(c);
+    test_alarm_fires(c, ext->first_event);
 
     xcb_disconnect(c);
     exit(0);
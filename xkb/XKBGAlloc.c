@@ -339,8 +339,14 @@ XkbFreeGeometry(XkbGeometryPtr geom, unsigned which, Bool freeMap)
 {
     if (geom == NULL)
         return;
-    if (freeMap)
+    if (freeMap) {
+        /* Still in use by other keyboard descriptions */
+        if (geom->refcnt > 1) {
+            geom->refcnt--;
+            return;
+        }
         which = XkbGeomAllMask;
+    }
     if ((which & XkbGeomPropertiesMask) && (geom->properties != NULL))
         XkbFreeGeomProperties(geom, 0, geom->num_properties, TRUE);
     if ((which & XkbGeomColorsMask) && (geom->colors != NULL))
@@ -494,7 +500,10 @@ XkbAllocGeometry(XkbDescPtr xkb, XkbGeometrySizesPtr sizes)
         xkb->geom = calloc(1, sizeof(XkbGeometryRec));
         if (!xkb->geom)
             return BadAlloc;
+        xkb->geom->refcnt = 1;
     }
+    else if (!XkbUnshareGeometry(xkb))
+        return BadAlloc;
     geom = xkb->geom;
     if ((sizes->which & XkbGeomPropertiesMask) &&
         ((rtrn = _XkbAllocProps(geom, sizes->num_properties)) != Success)) {
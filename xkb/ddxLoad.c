@@ -31,6 +31,9 @@ THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/time.h>
 #include <X11/X.h>
 #include <X11/Xos.h>
 #include <X11/Xproto.h>
@@ -41,6 +44,7 @@ THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #include "dix/dix_priv.h"
 #include "os/log_priv.h"
 #include "os/osdep.h"
+#include "os/xsha1.h"
 #include "xkb/xkbfile_priv.h"
 #include "xkb/xkbfmisc_priv.h"
 #include "xkb/xkbrules_priv.h"
@@ -99,6 +103,398 @@ OutputDirectory(char *outdir, size_t size)
     }
 }
 
+#if defined(HAVE_OPEN_MEMSTREAM) && !defined(WIN32)
+/*
+ * Compiled keymaps are kept in the output directory under a name derived
+ * from the xkbcomp input, the XKB data files it pulls in and the xkbcomp
+ * binary, so the same keymap only ever needs to be compiled once per data
+ * set.  The least recently used entries are dropped once there are too
+ * many.
+ */
+#define XKM_CACHE_PREFIX "xkbcache-"
+#define XKM_CACHE_MAX_ENTRIES 32
+#define XKM_CACHE_MAX_BYTES (4 * 1024 * 1024)
+#define XKM_CACHE_MAX_FILES 128        /* component files followed per key */
+#define XKM_CACHE_MAX_DEPTH 8          /* include nesting followed */
+
+static Bool
+XkbIsCachedKeymap(const char *keymap)
+{
+    return strncmp(keymap, XKM_CACHE_PREFIX, strlen(XKM_CACHE_PREFIX)) == 0;
+}
+
+static void
+XkbCacheHashStat(void *ctx, const char *path, const struct stat *st)
+{
+    x_sha1_update(ctx, path, strlen(path) + 1);
+    x_sha1_update(ctx, &st->st_ino, sizeof(st->st_ino));
+    x_sha1_update(ctx, &st->st_size, sizeof(st->st_size));
+    x_sha1_update(ctx, &st->st_mtime, sizeof(st->st_mtime));
+    x_sha1_update(ctx, &st->st_ctime, sizeof(st->st_ctime));
+}
+
+/*
+ * A cheap stamp of the data directory itself: files being added, removed
+ * or renamed show up in the directory times.
+ */
+static void
+XkbCacheHashDataDirs(void *ctx)
+{
+    static const char *subdirs[] = {
+        ".", "rules", "keycodes", "types", "compat", "symbols", "geometry"
+    };
+    char path[PATH_MAX];
+    struct stat st;
+
+    if (XkbBaseDirectory == NULL)
+        return;
+
+    for (int i = 0; i < ARRAY_SIZE(subdirs); i++) {
+        if (snprintf(path, sizeof(path), "%s/%s", XkbBaseDirectory,
+                     subdirs[i]) >= sizeof(path) || stat(path, &st) != 0)
+            continue;
+        XkbCacheHashStat(ctx, path, &st);
+    }
+}
+
+typedef struct {
+    void *ctx;
+    int nfiles;
+    char *files[XKM_CACHE_MAX_FILES];
+} XkbCacheDeps;
+
+static void
+XkbCacheScanIncludes(XkbCacheDeps *deps, const char *text, size_t len,
+                     const char *section, int depth);
+
+/*
+ * Put one component file into the key, and whatever it includes in turn.
+ * Editing a file in place changes its size or times even when its
+ * directory is left alone.
+ */
+static void
+XkbCacheHashComponent(XkbCacheDeps *deps, const char *section,
+                      const char *name, size_t namelen, int depth)
+{
+    char path[PATH_MAX];
+    struct stat st;
+    char *text;
+    FILE *file;
+    size_t len;
+
+    if (namelen == 0 || depth > XKM_CACHE_MAX_DEPTH ||
+        snprintf(path, sizeof(path), "%s/%s/%.*s", XkbBaseDirectory,
+                 section, (int) namelen, name) >= sizeof(path))
+        return;
+
+    for (int i = 0; i < deps->nfiles; i++)
+        if (strcmp(deps->files[i], path) == 0)
+            return;
+    if (deps->nfiles == XKM_CACHE_MAX_FILES)
+        return;
+    if (!(deps->files[deps->nfiles] = strdup(path)))
+        return;
+    deps->nfiles++;
+
+    /* a missing file is part of the key too: it may turn up later */
+    if (stat(path, &st) != 0) {
+        x_sha1_update(deps->ctx, path, strlen(path) + 1);
+        return;
+    }
+    XkbCacheHashStat(deps->ctx, path, &st);
+
+    if (!S_ISREG(st.st_mode) || !(file = fopen(path, "r")))
+        return;
+    text = malloc(st.st_size + 1);
+    if (text) {
+        len = fread(text, 1, st.st_size, file);
+        XkbCacheScanIncludes(deps, text, len, section, depth + 1);
+        free(text);
+    }
+    fclose(file);
+}
+
+/*
+ * Follow include (and augment, override, replace) statements, which name
+ * files of the section they appear in as "file(map)+file(map)|...".
+ */
+static void
+XkbCacheHashIncludeSpec(XkbCacheDeps *deps, const char *spec, size_t len,
+                        const char *section, int depth)
+{
+    size_t i = 0;
+
+    while (i < len) {
+        size_t start, end;
+
+        while (i < len && (spec[i] == '+' || spec[i] == '|' ||
+                           isspace((unsigned char) spec[i])))
+            i++;
+        start = i;
+        while (i < len && spec[i] != '(' && spec[i] != ':' &&
+               spec[i] != '+' && spec[i] != '|')
+            i++;
+        end = i;
+        while (i < len && spec[i] != '+' && spec[i] != '|')
+            i++;
+
+        /* stay inside the data directory */
+        if (end == start || spec[start] == '/')
+            continue;
+        for (size_t k = start; k + 1 < end; k++)
+            if (spec[k] == '.' && spec[k + 1] == '.')
+                start = end;
+        XkbCacheHashComponent(deps, section, spec + start, end - start,
+                              depth);
+    }
+}
+
+static void
+XkbCacheScanIncludes(XkbCacheDeps *deps, const char *text, size_t len,
+                     const char *section, int depth)
+{
+    static const struct {
+        const char *keyword;
+        const char *section;
+    } sections[] = {
+        { "xkb_keycodes", "keycodes" },
+        { "xkb_types", "types" },
+        { "xkb_compatibility", "compat" },
+        { "xkb_compatibility_map", "compat" },
+        { "xkb_compat", "compat" },
+        { "xkb_symbols", "symbols" },
+        { "xkb_geometry", "geometry" },
+    };
+    Bool want_file = FALSE;
+    size_t i = 0;
+
+    while (i < len) {
+        char c = text[i];
+
+        if (c == '#' || (c == '/' && i + 1 < len && text[i + 1] == '/')) {
+            while (i < len && text[i] != '\n')
+                i++;
+        }
+        else if (c == '/' && i + 1 < len && text[i + 1] == '*') {
+            for (i += 2; i + 1 < len; i++)
+                if (text[i] == '*' && text[i + 1] == '/')
+                    break;
+            i += 2;
+        }
+        else if (c == '"') {
+            size_t start = ++i;
+
+            while (i < len && text[i] != '"')
+                i++;
+            if (want_file && section)
+                XkbCacheHashIncludeSpec(deps, text + start, i - start,
+                                        section, depth);
+            want_file = FALSE;
+            i++;
+        }
+        else if (isalpha((unsigned char) c) || c == '_') {
+            size_t start = i, n;
+
+            while (i < len && (isalnum((unsigned char) text[i]) ||
+                               text[i] == '_'))
+                i++;
+            n = i - start;
+            want_file = (n == 7 && strncmp(text + start, "include", n) == 0) ||
+                        (n == 7 && strncmp(text + start, "augment", n) == 0) ||
+                        (n == 8 && strncmp(text + start, "override", n) == 0) ||
+                        (n == 7 && strncmp(text + start, "replace", n) == 0);
+            for (int k = 0; k < ARRAY_SIZE(sections); k++)
+                if (strlen(sections[k].keyword) == n &&
+                    strncmp(text + start, sections[k].keyword, n) == 0)
+                    section = sections[k].section;
+        }
+        else {
+            if (!isspace((unsigned char) c))
+                want_file = FALSE;
+            i++;
+        }
+    }
+}
+
+/*
+ * A different xkbcomp may well compile the same input differently; an
+ * upgrade replaces the binary, which changes its inode and times.
+ */
+static void
+XkbCacheHashCompiler(void *ctx, const char *xkbcomp)
+{
+    char path[PATH_MAX];
+    const char *dirs;
+    struct stat st;
+
+    x_sha1_update(ctx, xkbcomp, strlen(xkbcomp) + 1);
+    if (strchr(xkbcomp, '/')) {
+        if (stat(xkbcomp, &st) == 0)
+            XkbCacheHashStat(ctx, xkbcomp, &st);
+        return;
+    }
+
+    /* run through the shell, so it is found in $PATH */
+    for (dirs = getenv("PATH"); dirs && *dirs; ) {
+        size_t n = strcspn(dirs, ":");
+
+        if (snprintf(path, sizeof(path), "%.*s/%s", (int) n, dirs, xkbcomp)
+            < sizeof(path) && stat(path, &st) == 0) {
+            XkbCacheHashStat(ctx, path, &st);
+            return;
+        }
+        dirs += n;
+        if (*dirs == ':')
+            dirs++;
+    }
+}
+
+static Bool
+XkbCacheKeymapName(char *input, size_t len, const char *xkbcomp,
+                   char *name, size_t size)
+{
+    unsigned char sha1[20];
+    XkbCacheDeps deps = { .ctx = x_sha1_init() };
+    int n;
+
+    if (!deps.ctx)
+        return FALSE;
+    x_sha1_update(deps.ctx, input, len);
+    XkbCacheHashDataDirs(deps.ctx);
+    if (XkbBaseDirectory != NULL)
+        XkbCacheScanIncludes(&deps, input, len, NULL, 0);
+    for (int i = 0; i < deps.nfiles; i++)
+        free(deps.files[i]);
+    XkbCacheHashCompiler(deps.ctx, xkbcomp);
+    if (!x_sha1_final(deps.ctx, sha1))
+        return FALSE;
+
+    n = snprintf(name, size, "%s", XKM_CACHE_PREFIX);
+    for (int i = 0; i < sizeof(sha1) && n + 2 < size; i++)
+        n += snprintf(name + n, size - n, "%02x", sha1[i]);
+    return TRUE;
+}
+
+/*
+ * Only trust cache entries we wrote ourselves; the output directory may be
+ * shared with other users.  A hit is marked as recently used by touching
+ * the entry, which is what eviction goes by.
+ */
+static Bool
+XkbCacheLookup(const char *xkm_output_dir, const char *name)
+{
+    char path[PATH_MAX];
+    struct stat st;
+
+    if (snprintf(path, sizeof(path), "%s%s.xkm", xkm_output_dir, name)
+        >= sizeof(path))
+        return FALSE;
+    if (stat(path, &st) != 0)
+        return FALSE;
+    if (!S_ISREG(st.st_mode) || st.st_uid != geteuid() || st.st_size <= 0)
+        return FALSE;
+    (void) utimes(path, NULL);
+    return TRUE;
+}
+
+typedef struct {
+    char name[64];
+    time_t used;
+    off_t size;
+} XkbCacheEntry;
+
+static int
+XkbCacheEntryCompare(const void *a, const void *b)
+{
+    const XkbCacheEntry *ea = a, *eb = b;
+
+    return (ea->used > eb->used) - (ea->used < eb->used);
+}
+
+/*
+ * Keep the cache within XKM_CACHE_MAX_ENTRIES and XKM_CACHE_MAX_BYTES,
+ * dropping the least recently used entries first.  Clients can have any
+ * number of different keymaps compiled, so it must not grow unbounded.
+ */
+static void
+XkbCachePrune(const char *xkm_output_dir, const char *keep)
+{
+    XkbCacheEntry *entries = NULL;
+    int count = 0, alloced = 0;
+    off_t bytes = 0;
+    struct dirent *ent;
+    char path[PATH_MAX];
+    DIR *dir;
+
+    dir = opendir(xkm_output_dir);
+    if (!dir)
+        return;
+    while ((ent = readdir(dir))) {
+        struct stat st;
+
+        if (!XkbIsCachedKeymap(ent->d_name) ||
+            strncmp(ent->d_name, keep, strlen(keep)) == 0 ||
+            strlen(ent->d_name) >= sizeof(entries->name) ||
+            snprintf(path, sizeof(path), "%s%s", xkm_output_dir, ent->d_name)
+            >= sizeof(path) ||
+            stat(path, &st) != 0 ||
+            !S_ISREG(st.st_mode) || st.st_uid != geteuid())
+            continue;
+        if (count == alloced) {
+            XkbCacheEntry *grown;
+
+            alloced = alloced ? alloced * 2 : XKM_CACHE_MAX_ENTRIES * 2;
+            grown = reallocarray(entries, alloced, sizeof(*entries));
+            if (!grown)
+                break;
+            entries = grown;
+        }
+        strcpy(entries[count].name, ent->d_name);
+        entries[count].used = st.st_mtime;
+        entries[count].size = st.st_size;
+        bytes += st.st_size;
+        count++;
+    }
+    closedir(dir);
+
+    qsort(entries, count, sizeof(*entries), XkbCacheEntryCompare);
+    /* the entry just stored counts, but is never the one to go */
+    for (int i = 0; i < count &&
+         (count - i >= XKM_CACHE_MAX_ENTRIES || bytes > XKM_CACHE_MAX_BYTES);
+         i++) {
+        if (snprintf(path, sizeof(path), "%s%s", xkm_output_dir,
+                     entries[i].name) < sizeof(path) &&
+            unlink(path) == 0)
+            bytes -= entries[i].size;
+    }
+    free(entries);
+}
+
+static void
+XkbCacheStore(const char *xkm_output_dir, const char *keymap, const char *name)
+{
+    char from[PATH_MAX], to[PATH_MAX];
+
+    if (snprintf(from, sizeof(from), "%s%s.xkm", xkm_output_dir, keymap)
+        >= sizeof(from) ||
+        snprintf(to, sizeof(to), "%s%s.xkm", xkm_output_dir, name)
+        >= sizeof(to))
+        return;
+    if (rename(from, to) != 0) {
+        LogMessageVerb(X_WARNING, 4, "XKB: Could not cache keymap as %s\n",
+                       to);
+        return;
+    }
+    XkbCachePrune(xkm_output_dir, name);
+}
+#else
+static Bool
+XkbIsCachedKeymap(const char *keymap)
+{
+    return FALSE;
+}
+#endif
+
 /**
  * Callback invoked by XkbRunXkbComp. Write to out to talk to xkbcomp.
  */
@@ -107,9 +503,13 @@ typedef void (*xkbcomp_buffer_callback)(FILE *out, void *userdata);
 /**
  * Start xkbcomp, let the callback write into xkbcomp's stdin. When done,
  * return a strdup'd copy of the file name we've written to.
+ *
+ * If use_cache is set and the same input has been compiled before against
+ * the same XKB data by the same xkbcomp, xkbcomp isn't run at all and the
+ * name of the cached result is returned.
  */
 static char *
-RunXkbComp(xkbcomp_buffer_callback callback, void *userdata)
+RunXkbComp(xkbcomp_buffer_callback callback, void *userdata, Bool use_cache)
 {
     FILE *out;
     char *buf = NULL, keymap[PATH_MAX], xkm_output_dir[PATH_MAX];
@@ -132,17 +532,6 @@ RunXkbComp(xkbcomp_buffer_callback callback, void *userdata)
 
     OutputDirectory(xkm_output_dir, sizeof(xkm_output_dir));
 
-#ifdef WIN32
-    strcpy(tmpname, Win32TempDir());
-    strcat(tmpname, "\\xkb_XXXXXX");
-    (void) mktemp(tmpname);
-#endif
-
-    if (XkbBaseDirectory != NULL) {
-        if (asprintf(&xkbbasedirflag, "\"-R%s\"", XkbBaseDirectory) == -1)
-            xkbbasedirflag = NULL;
-    }
-
     if (XkbBinDirectory != NULL) {
         int ld = strlen(XkbBinDirectory);
         int lps = strlen(PATHSEPARATOR);
@@ -154,6 +543,44 @@ RunXkbComp(xkbcomp_buffer_callback callback, void *userdata)
         }
     }
 
+#ifdef XKM_CACHE_PREFIX
+    char *input = NULL, cached[64], xkbcomp[PATH_MAX];
+    size_t input_len = 0;
+
+    /* Never keep anything around in the world-writable fallback */
+    if (use_cache && strcmp(xkm_output_dir, "/tmp/") != 0) {
+        FILE *mem = open_memstream(&input, &input_len);
+
+        snprintf(xkbcomp, sizeof(xkbcomp), "%s%sxkbcomp",
+                 xkbbindir, xkbbindirsep);
+        if (mem) {
+            (*callback)(mem, userdata);
+            if (fclose(mem) != 0 ||
+                !XkbCacheKeymapName(input, input_len, xkbcomp,
+                                    cached, sizeof(cached))) {
+                free(input);
+                input = NULL;
+            }
+        }
+        if (input && XkbCacheLookup(xkm_output_dir, cached)) {
+            LogMessageVerb(X_INFO, 4, "XKB: Using cached keymap %s\n", cached);
+            free(input);
+            return strdup(cached);
+        }
+    }
+#endif
+
+#ifdef WIN32
+    strcpy(tmpname, Win32TempDir());
+    strcat(tmpname, "\\xkb_XXXXXX");
+    (void) mktemp(tmpname);
+#endif
+
+    if (XkbBaseDirectory != NULL) {
+        if (asprintf(&xkbbasedirflag, "\"-R%s\"", XkbBaseDirectory) == -1)
+            xkbbasedirflag = NULL;
+    }
+
     if (asprintf(&buf,
                  "\"%s%sxkbcomp\" -w %d %s -xkm \"%s\" "
                  "-em1 %s -emp %s -eml %s \"%s%s.xkm\"",
@@ -170,6 +597,9 @@ RunXkbComp(xkbcomp_buffer_callback callback, void *userdata)
     if (!buf) {
         LogMessage(X_ERROR,
                    "XKB: Could not invoke xkbcomp: not enough memory\n");
+#ifdef XKM_CACHE_PREFIX
+        free(input);
+#endif
         return NULL;
     }
 
@@ -181,6 +611,11 @@ RunXkbComp(xkbcomp_buffer_callback callback, void *userdata)
 
     if (out != NULL) {
         /* Now write to xkbcomp */
+#ifdef XKM_CACHE_PREFIX
+        if (input)
+            fwrite(input, input_len, 1, out);
+        else
+#endif
         (*callback)(out, userdata);
 
 #ifndef WIN32
@@ -194,6 +629,14 @@ RunXkbComp(xkbcomp_buffer_callback callback, void *userdata)
             free(buf);
 #ifdef WIN32
             unlink(tmpname);
+#endif
+#ifdef XKM_CACHE_PREFIX
+            if (input) {
+                free(input);
+                XkbCacheStore(xkm_output_dir, keymap, cached);
+                if (XkbCacheLookup(xkm_output_dir, cached))
+                    return strdup(cached);
+            }
 #endif
             return strdup(keymap);
         }
@@ -213,6 +656,9 @@ RunXkbComp(xkbcomp_buffer_callback callback, void *userdata)
         LogMessage(X_ERROR, "Could not open file %s\n", tmpname);
 #endif
     }
+#ifdef XKM_CACHE_PREFIX
+    free(input);
+#endif
     free(buf);
     return NULL;
 }
@@ -241,7 +687,8 @@ static Bool
 XkbDDXCompileKeymapByNames(XkbDescPtr xkb,
                            XkbComponentNamesPtr names,
                            unsigned want,
-                           unsigned need, char *nameRtrn, int nameRtrnLen)
+                           unsigned need, char *nameRtrn, int nameRtrnLen,
+                           Bool use_cache)
 {
     char *keymap;
     Bool rc = FALSE;
@@ -252,7 +699,7 @@ XkbDDXCompileKeymapByNames(XkbDescPtr xkb,
         .need = need
     };
 
-    keymap = RunXkbComp(xkb_write_keymap_for_names_cb, &ctx);
+    keymap = RunXkbComp(xkb_write_keymap_for_names_cb, &ctx, use_cache);
 
     if (keymap) {
         if(nameRtrn)
@@ -294,13 +741,20 @@ XkbDDXLoadKeymapFromString(DeviceIntPtr keybd,
 
     *xkbRtrn = NULL;
 
-    map_name = RunXkbComp(xkb_write_keymap_string_cb, &map);
+    map_name = RunXkbComp(xkb_write_keymap_string_cb, &map, TRUE);
     if (!map_name) {
         LogMessage(X_ERROR, "XKB: Couldn't compile keymap\n");
         return 0;
     }
 
     have = LoadXKM(want, need, map_name, xkbRtrn);
+    /* another server sharing the cache may have dropped the entry since */
+    if (!*xkbRtrn && XkbIsCachedKeymap(map_name)) {
+        free(map_name);
+        map_name = RunXkbComp(xkb_write_keymap_string_cb, &map, FALSE);
+        if (map_name)
+            have = LoadXKM(want, need, map_name, xkbRtrn);
+    }
     free(map_name);
 
     return have;
@@ -367,7 +821,8 @@ LoadXKM(unsigned want, unsigned need, const char *keymap, XkbDescPtr *xkbRtrn)
                (*xkbRtrn)->defined);
     }
     fclose(file);
-    (void) unlink(fileName);
+    if (!XkbIsCachedKeymap(keymap))
+        (void) unlink(fileName);
     return (need | want) & (~missing);
 }
 
@@ -379,6 +834,7 @@ XkbDDXLoadKeymapByNames(DeviceIntPtr keybd,
                         XkbDescPtr *xkbRtrn, char *nameRtrn, int nameRtrnLen)
 {
     XkbDescPtr xkb;
+    unsigned have;
 
     *xkbRtrn = NULL;
     if ((keybd == NULL) || (keybd->key == NULL) ||
@@ -394,12 +850,18 @@ XkbDDXLoadKeymapByNames(DeviceIntPtr keybd,
         return 0;
     }
     else if (!XkbDDXCompileKeymapByNames(xkb, names, want, need,
-                                         nameRtrn, nameRtrnLen)) {
+                                         nameRtrn, nameRtrnLen, TRUE)) {
         LogMessage(X_ERROR, "XKB: Couldn't compile keymap\n");
         return 0;
     }
 
-    return LoadXKM(want, need, nameRtrn, xkbRtrn);
+    have = LoadXKM(want, need, nameRtrn, xkbRtrn);
+    /* another server sharing the cache may have dropped the entry since */
+    if (!*xkbRtrn && nameRtrn && XkbIsCachedKeymap(nameRtrn) &&
+        XkbDDXCompileKeymapByNames(xkb, names, want, need,
+                                   nameRtrn, nameRtrnLen, FALSE))
+        have = LoadXKM(want, need, nameRtrn, xkbRtrn);
+    return have;
 }
 
 Bool
@@ -1423,7 +1423,7 @@ _XkbCopyCompat(XkbDescPtr src, XkbDescPtr dst)
 }
 
 static Bool
-_XkbCopyGeom(XkbDescPtr src, XkbDescPtr dst)
+_XkbDeepCopyGeom(XkbDescPtr src, XkbDescPtr dst)
 {
     void *tmp = NULL;
     int i = 0, j = 0, k = 0;
@@ -1922,6 +1922,56 @@ _XkbCopyGeom(XkbDescPtr src, XkbDescPtr dst)
     return TRUE;
 }
 
+/*
+ * Geometry is only ever replaced wholesale once built, so descriptions
+ * copied from one another simply share it. Anything about to modify a
+ * geometry in place must call XkbUnshareGeometry first.
+ */
+static Bool
+_XkbCopyGeom(XkbDescPtr src, XkbDescPtr dst)
+{
+    if (src->geom == dst->geom)
+        return TRUE;
+
+    if (dst->geom) {
+        XkbFreeGeometry(dst->geom, XkbGeomAllMask, TRUE);
+        dst->geom = NULL;
+    }
+    if (src->geom) {
+        src->geom->refcnt++;
+        dst->geom = src->geom;
+    }
+
+    return TRUE;
+}
+
+/**
+ * Give xkb a private copy of its geometry if it is shared with other
+ * keyboard descriptions.
+ */
+Bool
+XkbUnshareGeometry(XkbDescPtr xkb)
+{
+    XkbDescRec src = { .geom = xkb->geom };
+    XkbDescRec dst = { .geom = NULL };
+
+    if (!xkb->geom || xkb->geom->refcnt <= 1)
+        return TRUE;
+
+    if (!_XkbDeepCopyGeom(&src, &dst)) {
+        if (dst.geom) {
+            dst.geom->refcnt = 1;
+            XkbFreeGeometry(dst.geom, XkbGeomAllMask, TRUE);
+        }
+        return FALSE;
+    }
+    dst.geom->refcnt = 1;
+    xkb->geom->refcnt--;
+    xkb->geom = dst.geom;
+
+    return TRUE;
+}
+
 static Bool
 _XkbCopyIndicators(XkbDescPtr src, XkbDescPtr dst)
 {
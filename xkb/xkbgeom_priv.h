@@ -241,6 +241,8 @@ typedef struct _XkbGeometry {
     XkbSectionPtr sections;
     XkbDoodadPtr doodads;
     XkbKeyAliasPtr key_aliases;
+    /* number of keyboard descriptions sharing this geometry */
+    unsigned int refcnt;
 } XkbGeometryRec;
 
 #define	XkbGeomColorIndex(g,c)	((int)((c)-&(g)->colors[0]))
@@ -419,4 +421,7 @@ extern Status XkbAllocGeometry(XkbDescPtr /* xkb */ ,
                                XkbGeometrySizesPtr      /* sizes */
     );
 
+extern Bool XkbUnshareGeometry(XkbDescPtr /* xkb */
+    );
+
 #endif                          /* _XKBGEOM_H_ */